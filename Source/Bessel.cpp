@@ -0,0 +1,70 @@
+//
+//  Bessel.cpp
+//  FMCalculator
+//
+//  Bessel functions of the first kind for the FM sideband amplitudes.
+//
+//
+
+#include "Bessel.h"
+#include <algorithm>
+
+const double Bessel::maxIndex = 1000.0;
+
+int Bessel::orderLimit(double index)
+{
+		// Past the turning point n ~ x + x^(1/3) Jn(x) decays faster than
+		// exponentially, so this leaves a safe margin over the 0.1 cutoff.
+		double x = std::abs(index);
+		return (int)(x + 4.0 * std::pow(x, 1.0 / 3.0)) + 4;
+}
+
+void Bessel::compute(double index, int maxOrder, std::vector<double>& coefficients)
+{
+		maxOrder = std::max(maxOrder, 0);
+		coefficients.assign(maxOrder + 1, 0.0);
+		double* j = coefficients.data();
+		
+		double x = std::abs(index);
+		if (x < 1.0e-30)
+		{
+				j[0] = 1.0;
+				return;
+		}
+		
+		// Start well above both the highest wanted order and the argument so
+		// that the arbitrary seed has decayed away by the time we reach them.
+		int top = std::max(maxOrder, (int)x);
+		int start = 2 * ((top + 15 + (int)std::sqrt(40.0 * top)) / 2);
+		
+		double next = 0.0, current = 1.0e-30, evenSum = 0.0;
+		for (int k = start; k > 0; k--)
+		{
+				double previous = (2.0 * k / x) * current - next;
+				next = current;
+				current = previous;
+				
+				if (k - 1 <= maxOrder)
+						j[k - 1] = previous;
+				if (k - 1 > 0 && ((k - 1) & 1) == 0)
+						evenSum += previous;
+				
+				if (std::abs(current) > 1.0e250)
+				{
+						current *= 1.0e-250;
+						next *= 1.0e-250;
+						evenSum *= 1.0e-250;
+						for (int i = k - 1; i <= maxOrder; i++)
+								j[i] *= 1.0e-250;
+				}
+		}
+		
+		double norm = current + 2.0 * evenSum;
+		for (int i = 0; i <= maxOrder; i++)
+		{
+				j[i] /= norm;
+				// Jn(-x) = (-1)^n Jn(x)
+				if (index < 0 && (i & 1) != 0)
+						j[i] = -j[i];
+		}
+}
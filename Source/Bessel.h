@@ -0,0 +1,39 @@
+//
+//  Bessel.h
+//  FMCalculator
+//
+//  Bessel functions of the first kind for the FM sideband amplitudes.
+//
+//
+
+#ifndef __FMCalculator__Bessel__
+#define __FMCalculator__Bessel__
+
+#include <cmath>
+#include <vector>
+
+/** Computes every order J0(x)..Jn(x) of one argument in a single pass.
+
+    runFM needs all orders up to the sideband cutoff for the same index, so
+    instead of evaluating libm's jn() once per order (and once per look-ahead)
+    the whole vector is produced by Miller's backward recurrence and normalised
+    with the identity J0 + 2*(J2 + J4 + ...) = 1.
+*/
+class Bessel
+{
+public:
+		/** Largest |index| orderLimit and compute are defined for. The order
+		    limit and the cost of the recurrence both grow with the index, so
+		    the bound keeps the limit well inside an int and one spectrum's
+		    Bessel vector to about a thousand orders. */
+		static const double maxIndex;
+		
+		/** Returns an order above which no Jn(index) reaches the 0.1 sideband
+		    threshold used by FM::runFM. |index| must not exceed maxIndex. */
+		static int orderLimit(double index);
+		
+		/** Fills coefficients with J0(index)..Jn(index), n = maxOrder. */
+		static void compute(double index, int maxOrder, std::vector<double>& coefficients);
+};
+
+#endif /* defined(__FMCalculator__Bessel__) */
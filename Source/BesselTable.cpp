@@ -0,0 +1,155 @@
+//
+//  BesselTable.cpp
+//  FMCalculator
+//
+//  Precomputed Jn(index) on a fixed index grid, read from a mapped file.
+//
+//
+
+#include "BesselTable.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char tableMagic[4] = { 'F', 'M', 'J', 'N' };
+static const uint32_t tableVersion = 1;
+
+const double BesselTable::defaultMaxIndex = 30.0;
+const int BesselTable::defaultMaxOrder = 46;
+const double BesselTable::defaultAccuracy = 1.0e-10;
+
+BesselTable::BesselTable(const std::string& path)
+: _mapping(nullptr), _mappingSize(0), _header(nullptr), _values(nullptr)
+{
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+				return;
+		
+		struct stat info;
+		if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(Header))
+		{
+				void* mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+				if (mapping != MAP_FAILED)
+				{
+						_mapping = mapping;
+						_mappingSize = (size_t)info.st_size;
+				}
+		}
+		close(fd);
+		if (_mapping == nullptr)
+				return;
+		
+		const Header* header = static_cast<const Header*>(_mapping);
+		if (memcmp(header->magic, tableMagic, sizeof(tableMagic)) != 0
+		    || header->version != tableVersion
+		    || header->numOrders < 3 || header->numPoints < 2
+		    || _mappingSize < sizeof(Header) + (size_t)header->numOrders * header->numPoints * sizeof(double))
+				return;
+		
+		_header = header;
+		_values = reinterpret_cast<const double*>(header + 1);
+}
+
+BesselTable::~BesselTable()
+{
+		if (_mapping != nullptr)
+				munmap(_mapping, _mappingSize);
+}
+
+bool BesselTable::generate(const std::string& path, double maxIndex, int maxOrder, double accuracy)
+{
+		if (maxIndex <= 0.0 || maxOrder < 1 || accuracy <= 0.0)
+				return false;
+		
+		// One extra order supplies the slope of the highest served order.
+		Header header;
+		memcpy(header.magic, tableMagic, sizeof(tableMagic));
+		header.version = tableVersion;
+		header.numOrders = (uint32_t)maxOrder + 2;
+		header.numPoints = (uint32_t)std::ceil(maxIndex / std::pow(384.0 * accuracy, 0.25)) + 1;
+		header.indexStep = maxIndex / (header.numPoints - 1);
+		header.accuracy = accuracy;
+		
+		// Written beside the target and renamed over it, so that a process which
+		// still has the old table mapped never sees a truncated file.
+		std::string temporary = path + ".tmp";
+		FILE* out = fopen(temporary.c_str(), "wb");
+		if (out == nullptr)
+				return false;
+		
+		bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+		std::vector<double> coefficients;
+		for (uint32_t point = 0; ok && point < header.numPoints; point++)
+		{
+				Bessel::compute(point * header.indexStep, (int)header.numOrders - 1, coefficients);
+				ok = fwrite(coefficients.data(), sizeof(double), header.numOrders, out) == header.numOrders;
+		}
+		ok = (fclose(out) == 0) && ok;
+		if (ok)
+				ok = rename(temporary.c_str(), path.c_str()) == 0;
+		if (! ok)
+				remove(temporary.c_str());
+		return ok;
+}
+
+bool BesselTable::isValid() const
+{
+		return _header != nullptr;
+}
+
+double BesselTable::getMaxIndex() const
+{
+		return isValid() ? _header->indexStep * (_header->numPoints - 1) : 0.0;
+}
+
+int BesselTable::getMaxOrder() const
+{
+		return isValid() ? (int)_header->numOrders - 2 : -1;
+}
+
+double BesselTable::getAccuracy() const
+{
+		return isValid() ? _header->accuracy : 0.0;
+}
+
+bool BesselTable::lookup(double index, int maxOrder, std::vector<double>& coefficients) const
+{
+		double x = std::abs(index);
+		if (! isValid() || maxOrder < 0 || maxOrder > getMaxOrder() || x > getMaxIndex())
+				return false;
+		
+		const int numOrders = (int)_header->numOrders;
+		const double h = _header->indexStep;
+		
+		double position = x / h;
+		int point = std::min((int)position, (int)_header->numPoints - 2);
+		double t = position - point;
+		
+		const double* a = _values + (size_t)point * numOrders;
+		const double* b = a + numOrders;
+		
+		// Cubic Hermite basis, with the slopes scaled to the grid step.
+		double t2 = t * t, t3 = t2 * t;
+		double h00 = 2.0 * t3 - 3.0 * t2 + 1.0;
+		double h10 = (t3 - 2.0 * t2 + t) * h * 0.5;
+		double h01 = 3.0 * t2 - 2.0 * t3;
+		double h11 = (t3 - t2) * h * 0.5;
+		
+		coefficients.resize(maxOrder + 1);
+		double* j = coefficients.data();
+		
+		// J0' = -J1
+		j[0] = h00 * a[0] - h10 * 2.0 * a[1] + h01 * b[0] - h11 * 2.0 * b[1];
+		for (int n = 1; n <= maxOrder; n++)
+				j[n] = h00 * a[n] + h10 * (a[n-1] - a[n+1]) + h01 * b[n] + h11 * (b[n-1] - b[n+1]);
+		
+		// Jn(-x) = (-1)^n Jn(x)
+		if (index < 0)
+				for (int n = 1; n <= maxOrder; n += 2)
+						j[n] = -j[n];
+		return true;
+}
@@ -0,0 +1,77 @@
+//
+//  BesselTable.h
+//  FMCalculator
+//
+//  Precomputed Jn(index) on a fixed index grid, read from a mapped file.
+//
+//
+
+#ifndef __FMCalculator__BesselTable__
+#define __FMCalculator__BesselTable__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "Bessel.h"
+
+/** A read-only table of J0..Jn sampled over 0 <= index <= maxIndex.
+
+    The table lives in a binary file that is memory-mapped, so only the pages
+    that a sweep actually touches are ever read from disk. Values between grid
+    points are cubic Hermite interpolated, with the slopes taken from the
+    neighbouring orders (2 Jn' = Jn-1 - Jn+1), so no derivatives are stored.
+    The grid spacing is chosen when the table is generated from the accuracy
+    bound |error| <= h^4 / 384, which holds because |Jn''''| <= 1.
+
+    File layout: a Header followed by numPoints rows of numOrders doubles.
+*/
+class BesselTable
+{
+public:
+		/** Maps the table at path. Use isValid() to see if it could be used. */
+		explicit BesselTable(const std::string& path);
+		~BesselTable();
+		
+		/** The table the app generates on first run and fmcalc --generate-table
+		    writes by default: indices 0..30 (the whole index slider), orders
+		    0..46 (Bessel::orderLimit(30)) and an error below 1e-10, which is
+		    2144 rows of 48 orders, about 800 KB. */
+		static const double defaultMaxIndex;
+		static const int defaultMaxOrder;
+		static const double defaultAccuracy;
+		
+		/** Writes a table covering 0..maxIndex and orders 0..maxOrder whose
+		    interpolation error stays below accuracy. */
+		static bool generate(const std::string& path, double maxIndex, int maxOrder, double accuracy);
+		
+		bool isValid() const;
+		double getMaxIndex() const;
+		int getMaxOrder() const;
+		double getAccuracy() const;
+		
+		/** Fills coefficients with interpolated J0(index)..Jn(index), n = maxOrder.
+		    Returns false, leaving coefficients untouched, if the table does not
+		    cover the request. */
+		bool lookup(double index, int maxOrder, std::vector<double>& coefficients) const;
+		
+private:
+		struct Header
+		{
+				char magic[4];
+				uint32_t version;
+				uint32_t numOrders;
+				uint32_t numPoints;
+				double indexStep;
+				double accuracy;
+		};
+		
+		void* _mapping;
+		size_t _mappingSize;
+		const Header* _header;
+		const double* _values;
+		
+		BesselTable(const BesselTable&);
+		BesselTable& operator=(const BesselTable&);
+};
+
+#endif /* defined(__FMCalculator__BesselTable__) */
@@ -7,32 +7,120 @@
 //
 
 #include "FM.h"
+#include <algorithm>
 
-class MyArraySorter
+/** Walks the sidebands of one monotonic run of a spectrum in ascending order.
+
+    The upper sidebands c + n*m form one run. The lower sidebands c - n*m form
+    two: those still above 0 Hz (descending in n) and those reflected through
+    0 Hz (ascending in n), so each run is visited in whichever order of n gives
+    rising frequencies. Inaudible sidebands are skipped on the way.
+*/
+class SidebandRun
 {
 public:
-    static int compareElements(double a, double b)
-    {
-        if (a < b)
-            return -1;
-        else if (a > b)
-            return 1;
-        else // if a == b
-            return 0;
-    }
+		SidebandRun(double carrier, double cmratio, const double* bessel, int numOrders,
+		            bool lower, double sign)
+		: _carrier(carrier), _cmRatio(cmratio), _bessel(bessel), _lower(lower), _sign(sign)
+		{
+				double slope = lower ? -sign * cmratio * carrier : cmratio * carrier;
+				int first = lower ? 1 : 0;
+				if (slope >= 0)
+				{
+						_order = first;
+						_end = numOrders;
+						_step = 1;
+				}
+				else
+				{
+						_order = numOrders - 1;
+						_end = first - 1;
+						_step = -1;
+				}
+				skipInaudible();
+		}
+		
+		bool isFinished() const
+		{
+				// Ordered, so a run with no orders to walk (numOrders of 0 or 1 on the
+				// lower side) starts out finished instead of stepping past _end.
+				return _step > 0 ? _order >= _end : _order <= _end;
+		}
+		
+		double getFrequency() const
+		{
+				if (_lower)
+						return _sign * (_carrier - ( _order * _cmRatio * _carrier));
+				return _carrier + ( _order * _cmRatio * _carrier);
+		}
+		
+		double getAmplitude() const
+		{
+				double amplitude = _bessel[_order];
+				if (_lower && (_order & 1))
+						amplitude = -amplitude;     // J-n = (-1)^n Jn
+				return _sign * amplitude;       // sin(-wt) = -sin(wt)
+		}
+		
+		void next()
+		{
+				_order += _step;
+				skipInaudible();
+		}
+
+private:
+		void skipInaudible()
+		{
+				while (! isFinished() && ! isAudible(getFrequency()))
+						_order += _step;
+		}
+		
+		bool isAudible(double frequency) const
+		{
+				if (_lower)
+						return frequency > 20 && frequency < 4187;
+				return frequency < 4187;
+		}
+		
+		double _carrier, _cmRatio;
+		const double* _bessel;
+		bool _lower;
+		double _sign;
+		int _order, _end, _step;
 };
 
+const double FM::coincidenceTolerance = 1.0e-9;
 
-FM::FM(double carrier, double cmratio, double index)
+
+FM::FM(double carrier, double cmratio, double index, const BesselTable* table)
 {
 		_carrier = carrier;
 		_cmRatio = cmratio;
 		_index = index;
+		_table = table;
+		_exactRatio = false;
+		_numOrders = 0;
+		_besselValid = false;
+		_spectrumValid = false;
+		runFM();
+}
+
+FM::FM(double carrier, menc::Ratio cmratio, double index, const BesselTable* table)
+{
+		_carrier = carrier;
+		_index = index;
+		_table = table;
+		_exactRatio = false;
+		_numOrders = 0;
+		_besselValid = false;
+		setCMRatio(cmratio);
 		runFM();
 }
 
 void FM::setCarrier(double freq)
 {
+		if (freq != _carrier)
+				_spectrumValid = false;
 		_carrier = freq;
 }
 
@@ -43,7 +131,28 @@ double FM::getCarrier()
 
 void FM::setCMRatio(double ratio)
 {
+		if (ratio != _cmRatio || _exactRatio)
+				_spectrumValid = false;
 		_cmRatio = ratio;
+		_exactRatio = false;
+}
+
+void FM::setCMRatio(menc::Ratio ratio)
+{
+		_ratio = ratio;
+		_cmRatio = ratio.isDeterminate() ? (double)ratio.num() / ratio.den() : 0.0;
+		_exactRatio = true;
+		_spectrumValid = false;
+}
+
+bool FM::isExactRatio() const
+{
+		return _exactRatio;
+}
+
+menc::Ratio FM::getExactRatio() const
+{
+		return _ratio;
 }
 
 double FM::getModulator()
@@ -53,6 +162,8 @@ double FM::getModulator()
 
 void FM::setIndex(double index)
 {
+		if (index != _index)
+				_besselValid = false;
 		_index = index;
 }
 
@@ -61,28 +172,166 @@ double FM::getIndex()
 		return _index;
 }
 
-Array<double> FM::getSpectrum()
+void FM::setBesselTable(const BesselTable* table)
+{
+		if (table != _table)
+				_besselValid = false;
+		_table = table;
+}
+
+std::vector<double> FM::getSpectrum()
 {
-		return _spectrum;
+		std::vector<double> spectrum;
+		spectrum.reserve(_partials.size());
+		for (size_t i=0; i<_partials.size(); i++)
+				spectrum.push_back(_partials[i].frequency);
+		return spectrum;
+}
+
+const std::vector<Partial>& FM::getPartials() const
+{
+		return _partials;
+}
+
+const std::vector<double>& FM::getBessel() const
+{
+		return _bessel;
+}
+
+int FM::getNumOrders() const
+{
+		return _numOrders;
 }
 
 void FM::runFM()
 {
-		MyArraySorter sorter;
-		for(int i=0; std::abs(jn(i, _index)) > 0.1 || std::abs(jn(i+1, _index)) > 0.1 || std::abs(jn(i+2, _index)) > 0.1 ; i++)
+		if (! _besselValid)
 		{
-				double upperSideBand, lowerSideBand;
-				upperSideBand = _carrier + ( i * _cmRatio * _carrier);
-				lowerSideBand = _carrier - ( i * _cmRatio * _carrier);
-				
-				if (upperSideBand < 4187) {
-						_spectrum.addIfNotAlreadyThere(upperSideBand);
-				};
+				_numOrders = computeBessel(_index, _bessel, _table);
+				_besselValid = true;
+				_spectrumValid = false;
+		}
+		if (! _spectrumValid)
+		{
+				if (! (_exactRatio && mergeHarmonicSidebands()))
+						mergeSidebands(_carrier, _cmRatio, _bessel, _numOrders, _partials);
+				_spectrumValid = true;
+		}
+}
+
+static bool isLowerMultiple(const std::pair<int64_t, double>& a, const std::pair<int64_t, double>& b)
+{
+		return a.first < b.first;
+}
+
+bool FM::mergeHarmonicSidebands()
+{
+		// Sideband n of carrier c at ratio p/q sits at (c/q) * (q +- n*p), so
+		// each one is identified exactly by its integer multiple of c/q.
+		menc::Ratio ratio = _ratio;
+		if (! ratio.isDeterminate() || ratio.num() < 0 || _carrier <= 0)
+				return false;
+		
+		const int64_t p = ratio.num(), q = ratio.den();
+		const double fundamental = _carrier / q;
+		
+		_harmonics.clear();
+		_harmonics.reserve(2 * _numOrders);
+		for (int n=0; n<_numOrders; n++)
+		{
+				int64_t upper = q + n * p;
+				if (fundamental * upper < 4187)
+						_harmonics.push_back(std::make_pair(upper, _bessel[n]));
 				
-				if (std::abs(lowerSideBand) > 20 && std::abs(lowerSideBand) < 4187){
-						_spectrum.addIfNotAlreadyThere(abs(lowerSideBand));
-				};
+				int64_t lower = q - n * p;
+				double lowerSideBand = fundamental * std::abs(lower);
+				if (n > 0 && lowerSideBand > 20 && lowerSideBand < 4187)
+				{
+						double amplitude = (n & 1) ? -_bessel[n] : _bessel[n];  // J-n = (-1)^n Jn
+						if (lower < 0)
+								amplitude = -amplitude;                         // sin(-wt) = -sin(wt)
+						_harmonics.push_back(std::make_pair(std::abs(lower), amplitude));
+				}
+		}
+		
+		// Sorting the at most 2n sidebands costs O(n log n) however far apart
+		// the multiples are; the stable sort keeps the order the amplitudes of
+		// coinciding sidebands are summed in.
+		std::stable_sort(_harmonics.begin(), _harmonics.end(), isLowerMultiple);
+		
+		_partials.clear();
+		_partials.reserve(_harmonics.size());
+		for (size_t i=0; i<_harmonics.size(); i++)
+		{
+				if (i > 0 && _harmonics[i].first == _harmonics[i-1].first)
+						_partials.back().amplitude += _harmonics[i].second;
+				else
+						_partials.push_back(Partial(fundamental * _harmonics[i].first, _harmonics[i].second));
 		}
-		_spectrum.sort(sorter);
+		return true;
 }
 
+void FM::computeSpectrum(double carrier, double cmratio, double index,
+                         std::vector<double>& bessel, std::vector<Partial>& partials,
+                         const BesselTable* table)
+{
+		int numOrders = computeBessel(index, bessel, table);
+		mergeSidebands(carrier, cmratio, bessel, numOrders, partials);
+}
+
+int FM::computeBessel(double index, std::vector<double>& bessel, const BesselTable* table)
+{
+		int maxOrder = Bessel::orderLimit(index);
+		if (table == nullptr || ! table->lookup(index, maxOrder, bessel))
+				Bessel::compute(index, maxOrder, bessel);
+		// orderLimit keeps the last orders below the cutoff, so the look-ahead
+		// stays inside the vector.
+		int numOrders = 0;
+		while (numOrders + 2 < (int)bessel.size()
+		       && (std::abs(bessel[numOrders]) > 0.1 || std::abs(bessel[numOrders+1]) > 0.1 || std::abs(bessel[numOrders+2]) > 0.1))
+				numOrders++;
+		return numOrders;
+}
+
+void FM::mergeSidebands(double carrier, double cmratio,
+                        const std::vector<double>& bessel, int numOrders,
+                        std::vector<Partial>& partials)
+{
+		partials.clear();
+		if (numOrders <= 0)
+				return;
+		partials.reserve(2 * numOrders);
+		
+		SidebandRun runs[3] = {
+				SidebandRun(carrier, cmratio, bessel.data(), numOrders, false, 1.0),
+				SidebandRun(carrier, cmratio, bessel.data(), numOrders, true, 1.0),
+				SidebandRun(carrier, cmratio, bessel.data(), numOrders, true, -1.0)
+		};
+		
+		// Three-way merge; partials that coincide within the tolerance add
+		// their signed amplitudes into the one already emitted.
+		for (;;)
+		{
+				int lowest = -1;
+				for (int run=0; run<3; run++)
+						if (! runs[run].isFinished() && (lowest < 0 || runs[run].getFrequency() < runs[lowest].getFrequency()))
+								lowest = run;
+				if (lowest < 0)
+						break;
+				
+				double frequency = runs[lowest].getFrequency();
+				double amplitude = runs[lowest].getAmplitude();
+				runs[lowest].next();
+				
+				if (! partials.empty())
+				{
+						Partial& last = partials.back();
+						if (frequency - last.frequency <= coincidenceTolerance * std::abs(frequency))
+						{
+								last.amplitude += amplitude;
+								continue;
+						}
+				}
+				partials.push_back(Partial(frequency, amplitude));
+		}
+}
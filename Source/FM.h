@@ -11,7 +11,28 @@
 
 #include <iostream>
 #include <cmath>
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <utility>
+#include <vector>
+#include "BesselTable.h"
+#include "../menc/mencRational.h"
+
+/** One component of an FM spectrum.
+
+    amplitude is signed: sideband n carries Jn(index), lower sidebands pick up
+    (-1)^n, and sidebands reflected through 0 Hz are inverted. A negative
+    amplitude therefore means the partial is at phase pi relative to the carrier.
+*/
+struct Partial
+{
+		Partial() : frequency(0.0), amplitude(0.0) {}
+		Partial(double freq, double amp) : frequency(freq), amplitude(amp) {}
+		
+		double getMagnitude() const     { return std::abs(amplitude); }
+		double getPhase() const         { return amplitude < 0.0 ? M_PI : 0.0; }
+		
+		double frequency;
+		double amplitude;
+};
 
 class FM
 {
@@ -19,18 +40,68 @@ private:
 		double _carrier;
 		double _cmRatio;
 		double _index;
-		Array<double> _spectrum;
+		std::vector<Partial> _partials;
+		std::vector<double> _bessel;
+		int _numOrders;
+		const BesselTable* _table;
+		
+		// In exact ratio mode every sideband is an integer multiple of
+		// carrier / denominator, and coincident sidebands share a multiple.
+		bool _exactRatio;
+		menc::Ratio _ratio;
+		std::vector<std::pair<int64_t, double> > _harmonics;
+		
+		// The Bessel vector and cutoff depend only on the index, so carrier and
+		// ratio changes only invalidate the merged spectrum.
+		bool _besselValid;
+		bool _spectrumValid;
+		
+		bool mergeHarmonicSidebands();
 		
 public:
-		FM(double carrier, double cmratio, double index);
+		/** If table is given, Bessel values are interpolated from it wherever it
+		    covers the index; otherwise (or outside it) they are computed exactly. */
+		FM(double carrier, double cmratio, double index, const BesselTable* table = nullptr);
+		FM(double carrier, menc::Ratio cmratio, double index, const BesselTable* table = nullptr);
 		void setCarrier(double freq);
 		double getCarrier();
 		void setCMRatio(double ratio);
+		
+		/** Switches to exact ratio mode: sidebands are placed at exact multiples
+		    of carrier / denominator and merged by their integer multiple. */
+		void setCMRatio(menc::Ratio ratio);
+		bool isExactRatio() const;
+		menc::Ratio getExactRatio() const;
 		double getModulator();
 		void setIndex(double index);
 		double getIndex();
-		Array<double> getSpectrum();
+		void setBesselTable(const BesselTable* table);
+		std::vector<double> getSpectrum();
+		const std::vector<Partial>& getPartials() const;
+		const std::vector<double>& getBessel() const;
+		int getNumOrders() const;
+		
+		/** Recomputes whatever the setters have invalidated since the last run. */
 		void runFM();
+		
+		/** Relative distance below which two sidebands count as the same partial. */
+		static const double coincidenceTolerance;
+		
+		/** Computes one spectrum into caller-owned buffers, so that batch code can
+		    reuse the same storage for every parameter triple. */
+		static void computeSpectrum(double carrier, double cmratio, double index,
+		                            std::vector<double>& bessel, std::vector<Partial>& partials,
+		                            const BesselTable* table = nullptr);
+		
+		/** Fills bessel for index and returns the number of sideband orders
+		    (including the carrier) above the 0.1 cutoff. */
+		static int computeBessel(double index, std::vector<double>& bessel,
+		                         const BesselTable* table = nullptr);
+		
+		/** Merges the first numOrders sidebands into a sorted spectrum. */
+		static void mergeSidebands(double carrier, double cmratio,
+		                           const std::vector<double>& bessel, int numOrders,
+		                           std::vector<Partial>& partials);
 };
 
 #endif /* defined(__FMCalculator__FM__) */
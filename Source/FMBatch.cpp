@@ -0,0 +1,149 @@
+//
+//  FMBatch.cpp
+//  FMCalculator
+//
+//  Computes many FM spectra at once for parameter sweeps.
+//
+//
+
+#include "FMBatch.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+/** One contiguous range of triples and the spectra computed for it. */
+struct SweepRange
+{
+		size_t start, end;
+		std::vector<double> frequencies;
+		std::vector<double> amplitudes;
+};
+
+/** State shared by the worker threads of one FMBatch::run. */
+struct Sweep
+{
+		const double* carriers;
+		const double* cmratios;
+		const double* indices;
+		const BesselTable* table;
+		
+		// Each slot first receives the size of spectrum i, then becomes its offset.
+		size_t* sizes;
+		
+		std::vector<SweepRange> ranges;
+		std::atomic<size_t> nextRange;
+};
+
+static void runSweep(Sweep* sweep)
+{
+		std::vector<double> bessel;
+		std::vector<Partial> partials;
+		
+		for (;;)
+		{
+				size_t next = sweep->nextRange++;
+				if (next >= sweep->ranges.size())
+						return;
+				
+				SweepRange& range = sweep->ranges[next];
+				for (size_t i = range.start; i < range.end; i++)
+				{
+						FM::computeSpectrum(sweep->carriers[i], sweep->cmratios[i], sweep->indices[i],
+						                    bessel, partials, sweep->table);
+						sweep->sizes[i] = partials.size();
+						for (size_t k = 0; k < partials.size(); k++)
+						{
+								range.frequencies.push_back(partials[k].frequency);
+								range.amplitudes.push_back(partials[k].amplitude);
+						}
+				}
+		}
+}
+
+FMBatch::FMBatch()
+: _offsets(1, 0)
+{
+}
+
+void FMBatch::run(const double* carriers, const double* cmratios, const double* indices,
+                  size_t count, int numThreads, const BesselTable* table)
+{
+		if (numThreads <= 0)
+				numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+		
+		_offsets.assign(count + 1, 0);
+		_frequencies.clear();
+		_amplitudes.clear();
+		
+		Sweep sweep;
+		sweep.carriers = carriers;
+		sweep.cmratios = cmratios;
+		sweep.indices = indices;
+		sweep.table = table;
+		sweep.sizes = _offsets.data() + 1;
+		sweep.nextRange = 0;
+		
+		// A few ranges per thread keeps the load balanced when high indices
+		// (long spectra) are clustered in one part of the sweep.
+		size_t numRanges = std::max((size_t)1, std::min(count, (size_t)numThreads * 4));
+		sweep.ranges.resize(numRanges);
+		for (size_t r = 0; r < numRanges; r++)
+		{
+				sweep.ranges[r].start = count * r / numRanges;
+				sweep.ranges[r].end = count * (r + 1) / numRanges;
+		}
+		
+		std::vector<std::thread> threads;
+		for (int t = 1; t < numThreads; t++)
+				threads.push_back(std::thread(runSweep, &sweep));
+		runSweep(&sweep);
+		for (size_t t = 0; t < threads.size(); t++)
+				threads[t].join();
+		
+		for (size_t i = 0; i < count; i++)
+				_offsets[i + 1] += _offsets[i];
+		
+		_frequencies.reserve(_offsets[count]);
+		_amplitudes.reserve(_offsets[count]);
+		for (size_t r = 0; r < numRanges; r++)
+		{
+				const SweepRange& range = sweep.ranges[r];
+				_frequencies.insert(_frequencies.end(), range.frequencies.begin(), range.frequencies.end());
+				_amplitudes.insert(_amplitudes.end(), range.amplitudes.begin(), range.amplitudes.end());
+		}
+}
+
+size_t FMBatch::getNumSpectra() const
+{
+		return _offsets.size() - 1;
+}
+
+size_t FMBatch::getSpectrumSize(size_t spectrum) const
+{
+		return _offsets[spectrum + 1] - _offsets[spectrum];
+}
+
+const double* FMBatch::getSpectrum(size_t spectrum) const
+{
+		return _frequencies.data() + _offsets[spectrum];
+}
+
+const double* FMBatch::getAmplitudes(size_t spectrum) const
+{
+		return _amplitudes.data() + _offsets[spectrum];
+}
+
+const std::vector<size_t>& FMBatch::getOffsets() const
+{
+		return _offsets;
+}
+
+const std::vector<double>& FMBatch::getFrequencies() const
+{
+		return _frequencies;
+}
+
+const std::vector<double>& FMBatch::getAmplitudes() const
+{
+		return _amplitudes;
+}
@@ -0,0 +1,51 @@
+//
+//  FMBatch.h
+//  FMCalculator
+//
+//  Computes many FM spectra at once for parameter sweeps.
+//
+//
+
+#ifndef __FMCalculator__FMBatch__
+#define __FMCalculator__FMBatch__
+
+#include "FM.h"
+
+/** Runs FM::computeSpectrum over arrays of (carrier, ratio, index) triples on
+    all cores and packs every spectrum into one flat buffer.
+
+    Spectrum i occupies frequencies[offsets[i]] .. frequencies[offsets[i+1] - 1],
+    with the signed sideband amplitudes at the same positions in amplitudes.
+    No FM objects are constructed and no per-spectrum arrays are allocated:
+    each worker reuses its own scratch buffers for a contiguous range of
+    triples and the ranges are concatenated in input order at the end.
+*/
+class FMBatch
+{
+public:
+		FMBatch();
+		
+		/** Computes count spectra. If numThreads is 0 one worker per CPU is used.
+		    An optional BesselTable replaces the exact Bessel evaluation. */
+		void run(const double* carriers, const double* cmratios, const double* indices,
+		         size_t count, int numThreads = 0, const BesselTable* table = nullptr);
+		
+		size_t getNumSpectra() const;
+		size_t getSpectrumSize(size_t spectrum) const;
+		const double* getSpectrum(size_t spectrum) const;
+		const double* getAmplitudes(size_t spectrum) const;
+		
+		const std::vector<size_t>& getOffsets() const;
+		const std::vector<double>& getFrequencies() const;
+		const std::vector<double>& getAmplitudes() const;
+		
+private:
+		std::vector<size_t> _offsets;
+		std::vector<double> _frequencies;
+		std::vector<double> _amplitudes;
+		
+		FMBatch(const FMBatch&);
+		FMBatch& operator=(const FMBatch&);
+};
+
+#endif /* defined(__FMCalculator__FMBatch__) */
@@ -0,0 +1,304 @@
+//
+//  KeyFinder.cpp
+//  FMCalculator
+//
+//  Finds the key of spectra and score passages from pitch-class weights.
+//
+//
+
+#include "KeyFinder.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include "FMBatch.h"
+#include "KeyNumbers.h"
+
+#if defined(__AVX__)
+ #include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define FM_KEYFINDER_SSE2 1
+#endif
+
+// Krumhansl and Kessler's probe-tone ratings for C major and C minor.
+static const double majorProfile[KeyFinder::numPitchClasses] =
+		{6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88};
+static const double minorProfile[KeyFinder::numPitchClasses] =
+		{6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17};
+
+/** The profiles rotated to every tonic, centred and scaled to unit length so
+    a dot product with centred weights is a correlation up to the length of
+    the weights. Stored pitch class by pitch class, so the 24 scores are
+    accumulated side by side. */
+struct KeyTemplates
+{
+		float columns[KeyFinder::numPitchClasses][KeyFinder::numKeys];
+		
+		KeyTemplates()
+		{
+				for (int key = 0; key < KeyFinder::numKeys; key++)
+				{
+						const double* profile = key < 12 ? majorProfile : minorProfile;
+						double mean = 0.0, length = 0.0;
+						for (int pc = 0; pc < 12; pc++)
+								mean += profile[pc] / 12.0;
+						for (int pc = 0; pc < 12; pc++)
+								length += (profile[pc] - mean) * (profile[pc] - mean);
+						length = std::sqrt(length);
+		
+						int tonic = key % 12;
+						for (int pc = 0; pc < 12; pc++)
+								columns[(pc + tonic) % 12][key] = (float)((profile[pc] - mean) / length);
+				}
+		}
+};
+
+static const KeyTemplates& keyTemplates()
+{
+		static const KeyTemplates templates;
+		return templates;
+}
+
+void KeyFinder::scoreKeys(const float* weights, float* scores)
+{
+		// The templates are centred, so the mean of the weights drops out of the
+		// dot products and is only needed for their length.
+		float mean = 0.0f;
+		for (int pc = 0; pc < numPitchClasses; pc++)
+				mean += weights[pc];
+		mean /= numPitchClasses;
+		float length = 0.0f;
+		for (int pc = 0; pc < numPitchClasses; pc++)
+				length += (weights[pc] - mean) * (weights[pc] - mean);
+		length = std::sqrt(length);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		
+		const KeyTemplates& templates = keyTemplates();
+#if defined(__AVX__)
+		__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps(), sum2 = _mm256_setzero_ps();
+		for (int pc = 0; pc < numPitchClasses; pc++)
+		{
+				const __m256 w = _mm256_set1_ps(weights[pc]);
+				sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(w, _mm256_loadu_ps(templates.columns[pc])));
+				sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(w, _mm256_loadu_ps(templates.columns[pc] + 8)));
+				sum2 = _mm256_add_ps(sum2, _mm256_mul_ps(w, _mm256_loadu_ps(templates.columns[pc] + 16)));
+		}
+		const __m256 s = _mm256_set1_ps(scale);
+		_mm256_storeu_ps(scores, _mm256_mul_ps(sum0, s));
+		_mm256_storeu_ps(scores + 8, _mm256_mul_ps(sum1, s));
+		_mm256_storeu_ps(scores + 16, _mm256_mul_ps(sum2, s));
+#elif FM_KEYFINDER_SSE2
+		__m128 sums[6];
+		for (int i = 0; i < 6; i++)
+				sums[i] = _mm_setzero_ps();
+		for (int pc = 0; pc < numPitchClasses; pc++)
+		{
+				const __m128 w = _mm_set1_ps(weights[pc]);
+				for (int i = 0; i < 6; i++)
+						sums[i] = _mm_add_ps(sums[i], _mm_mul_ps(w, _mm_loadu_ps(templates.columns[pc] + 4 * i)));
+		}
+		const __m128 s = _mm_set1_ps(scale);
+		for (int i = 0; i < 6; i++)
+				_mm_storeu_ps(scores + 4 * i, _mm_mul_ps(sums[i], s));
+#else
+		for (int key = 0; key < numKeys; key++)
+				scores[key] = 0.0f;
+		for (int pc = 0; pc < numPitchClasses; pc++)
+				for (int key = 0; key < numKeys; key++)
+						scores[key] += weights[pc] * templates.columns[pc][key];
+		for (int key = 0; key < numKeys; key++)
+				scores[key] *= scale;
+#endif
+}
+
+int KeyFinder::findKeyIndex(const float* weights)
+{
+		float scores[numKeys];
+		scoreKeys(weights, scores);
+		
+		int best = -1;
+		float bestScore = 0.0f;
+		for (int key = 0; key < numKeys; key++)
+		{
+				if (scores[key] > bestScore)
+				{
+						best = key;
+						bestScore = scores[key];
+				}
+		}
+		return best;
+}
+
+menc::Key KeyFinder::findKey(const float* weights)
+{
+		return toKey(findKeyIndex(weights));
+}
+
+menc::Key KeyFinder::toKey(int keyIndex)
+{
+		using menc::Keys;
+		static const menc::Key keys[numKeys] =
+		{
+				Keys::C_Major, Keys::Df_Major, Keys::D_Major, Keys::Ef_Major, Keys::E_Major, Keys::F_Major,
+				Keys::Fs_Major, Keys::G_Major, Keys::Af_Major, Keys::A_Major, Keys::Bf_Major, Keys::B_Major,
+				Keys::C_Minor, Keys::Cs_Minor, Keys::D_Minor, Keys::Ef_Minor, Keys::E_Minor, Keys::F_Minor,
+				Keys::Fs_Minor, Keys::G_Minor, Keys::Gs_Minor, Keys::A_Minor, Keys::Bf_Minor, Keys::B_Minor
+		};
+		if (keyIndex < 0 || keyIndex >= numKeys)
+				return Keys::Empty;
+		return keys[keyIndex];
+}
+
+void KeyFinder::addSpectrum(const double* frequencies, const double* amplitudes, size_t count,
+                            float* weights)
+{
+		int keys[256];
+		float cents[256];
+		for (size_t start = 0; start < count; start += 256)
+		{
+				size_t n = std::min(count - start, (size_t)256);
+				KeyNumbers::fromFrequencies(frequencies + start, n, keys, cents);
+				for (size_t i = 0; i < n; i++)
+				{
+						if (keys[i] == KeyNumbers::invalidKey)
+								continue;
+						weights[((keys[i] % 12) + 12) % 12] += (float)std::abs(amplitudes[start + i]);
+				}
+		}
+}
+
+menc::Key KeyFinder::findKey(const double* frequencies, const double* amplitudes, size_t count)
+{
+		float weights[numPitchClasses] = {0};
+		addSpectrum(frequencies, amplitudes, count, weights);
+		return findKey(weights);
+}
+
+/** State shared by the worker threads of one KeyFinder::findKeys. */
+struct KeySweep
+{
+		const FMBatch* batch;
+		menc::Key* keys;
+		size_t count, rangeSize;
+		std::atomic<size_t> nextRange;
+};
+
+static void runKeySweep(KeySweep* sweep)
+{
+		const FMBatch& batch = *sweep->batch;
+		
+		for (;;)
+		{
+				size_t start = sweep->nextRange++ * sweep->rangeSize;
+				if (start >= sweep->count)
+						return;
+		
+				size_t end = std::min(sweep->count, start + sweep->rangeSize);
+				for (size_t i = start; i < end; i++)
+						sweep->keys[i] = KeyFinder::findKey(batch.getSpectrum(i), batch.getAmplitudes(i),
+						                                    batch.getSpectrumSize(i));
+		}
+}
+
+void KeyFinder::findKeys(const FMBatch& batch, std::vector<menc::Key>& keys, int numThreads)
+{
+		if (numThreads <= 0)
+				numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+		
+		size_t count = batch.getNumSpectra();
+		keys.resize(count);
+		
+		// Build the templates before the workers race to do it.
+		keyTemplates();
+		
+		KeySweep sweep;
+		sweep.batch = &batch;
+		sweep.keys = keys.data();
+		sweep.count = count;
+		sweep.rangeSize = 1024;
+		sweep.nextRange = 0;
+		
+		std::vector<std::thread> threads;
+		for (int t = 1; t < numThreads && (size_t)t * sweep.rangeSize < count; t++)
+				threads.push_back(std::thread(runKeySweep, &sweep));
+		runKeySweep(&sweep);
+		for (size_t t = 0; t < threads.size(); t++)
+				threads[t].join();
+}
+
+void KeyFinder::findKeys(menc::Score& score, menc::Ratio windowLength, std::vector<ScoreKey>& keys)
+{
+		keys.clear();
+		Window window(windowLength, keys);
+		score.doMoments(&window);
+}
+
+KeyFinder::Window::Window(menc::Ratio length, std::vector<ScoreKey>& keys)
+: _length(length), _time(0), _filled(0), _keys(keys)
+{
+		for (int pc = 0; pc < numPitchClasses; pc++)
+				_weights[pc] = 0.0;
+}
+
+void KeyFinder::Window::add(int pitchClasses, double duration)
+{
+		for (int pc = 0; pc < numPitchClasses; pc++)
+				if ((pitchClasses >> pc) & 1)
+						_weights[pc] += duration;
+}
+
+void KeyFinder::Window::momentHandlerCallback(menc::Score*, menc::Ratio momentDuration,
+                                              menc::Array<menc::ScoreData*>& momentData)
+{
+		if (momentDuration <= 0)
+				return;
+		
+		int pitchClasses = 0;
+		for (int i = 0; i < momentData.size(); i++)
+		{
+				menc::NoteData* data = dynamic_cast<menc::NoteData*>(momentData[i]);
+				if (data == nullptr || data->isRest() || !data->getNote().valid())
+						continue;
+				pitchClasses |= 1 << (((data->getNote().toMIDIKeyNumber() % 12) + 12) % 12);
+		}
+		
+		Moment moment;
+		moment.pitchClasses = pitchClasses;
+		moment.duration = momentDuration;
+		_moments.push_back(moment);
+		add(pitchClasses, momentDuration.to<double>());
+		_filled += momentDuration;
+		
+		// Drop what has slid out of the window, trimming the oldest moment
+		// when only part of it has.
+		while (_filled > _length && !_moments.empty())
+		{
+				Moment& oldest = _moments.front();
+				menc::Ratio excess = _filled - _length;
+				if (oldest.duration <= excess)
+				{
+						add(oldest.pitchClasses, -oldest.duration.to<double>());
+						_filled -= oldest.duration;
+						_moments.pop_front();
+				}
+				else
+				{
+						add(oldest.pitchClasses, -excess.to<double>());
+						oldest.duration -= excess;
+						_filled -= excess;
+				}
+		}
+		
+		float weights[numPitchClasses];
+		for (int pc = 0; pc < numPitchClasses; pc++)
+				weights[pc] = (float)_weights[pc];
+		
+		_time += momentDuration;
+		
+		ScoreKey key;
+		key.time = _time;
+		key.key = findKey(weights);
+		_keys.push_back(key);
+}
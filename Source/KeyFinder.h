@@ -0,0 +1,102 @@
+//
+//  KeyFinder.h
+//  FMCalculator
+//
+//  Finds the key of spectra and score passages from pitch-class weights.
+//
+//
+
+#ifndef __FMCalculator__KeyFinder__
+#define __FMCalculator__KeyFinder__
+
+#include <stddef.h>
+#include <deque>
+#include <vector>
+#include "../menc/coremusic.h"
+
+class FMBatch;
+
+/** Key finding in the manner of Krumhansl and Schmuckler: a weight for each
+    pitch class (C first) is correlated with the Krumhansl-Kessler major and
+    minor profiles rotated to each of the 12 tonics, and the best of the 24
+    gives the key.
+
+    The profiles are stored centred and normalised, so the correlations for
+    all 24 keys are one 24 x 12 matrix-vector product, run with AVX or SSE
+    when the compiler targets them. Each tonic is spelled as the menc key
+    with the fewest accidentals (Db major, C# minor, F# major, Eb minor, ...).
+*/
+class KeyFinder
+{
+public:
+		static const int numPitchClasses = 12;
+		
+		/** Keys are numbered by tonic pitch class, 0..11 major, 12..23 minor. */
+		static const int numKeys = 24;
+		
+		/** Sets scores[k] to the correlation of the weights with key k, -1 to 1.
+		    Weights that are all equal give 0 for every key. */
+		static void scoreKeys(const float* weights, float* scores);
+		
+		/** The index of the best-scoring key, or -1 if no key correlates
+		    positively with the weights (as when all weights are equal). */
+		static int findKeyIndex(const float* weights);
+		
+		/** The best key for the weights, or menc::Keys::Empty. */
+		static menc::Key findKey(const float* weights);
+		
+		/** The menc key for a key index, or menc::Keys::Empty if out of range. */
+		static menc::Key toKey(int keyIndex);
+		
+		/** Adds each partial's magnitude to the pitch class of its nearest key,
+		    as KeyNumbers rounds it. */
+		static void addSpectrum(const double* frequencies, const double* amplitudes, size_t count,
+		                        float* weights);
+		
+		/** The key of one spectrum. */
+		static menc::Key findKey(const double* frequencies, const double* amplitudes, size_t count);
+		
+		/** The key of every spectrum of a sweep. If numThreads is 0 one worker per
+		    CPU is used. */
+		static void findKeys(const FMBatch& batch, std::vector<menc::Key>& keys, int numThreads = 0);
+		
+		/** The key at one moment of a score, found over the window ending there. */
+		struct ScoreKey
+		{
+				menc::Ratio time;       // the end of the moment and of the window
+				menc::Key key;
+		};
+		
+		/** Finds the key at every moment of a score over a sliding window of the
+		    given length in whole notes, weighting each sounding pitch class by
+		    how long it sounds in the window. Moments entering and leaving the
+		    window update the weights instead of recounting the window. */
+		static void findKeys(menc::Score& score, menc::Ratio windowLength, std::vector<ScoreKey>& keys);
+
+private:
+		/** Walks the moments of a score and keeps the window's weights. */
+		class Window : public menc::Score::MomentHandler
+		{
+		public:
+				Window(menc::Ratio length, std::vector<ScoreKey>& keys);
+		
+				void momentHandlerCallback(menc::Score* score, menc::Ratio momentDuration,
+				                           menc::Array<menc::ScoreData*>& momentData);
+		
+		private:
+				struct Moment
+				{
+						int pitchClasses;
+						menc::Ratio duration;
+				};
+		
+				void add(int pitchClasses, double duration);
+		
+				menc::Ratio _length, _time, _filled;
+				std::deque<Moment> _moments;
+				double _weights[numPitchClasses];
+				std::vector<ScoreKey>& _keys;
+		};
+};
+
+#endif /* defined(__FMCalculator__KeyFinder__) */
@@ -0,0 +1,205 @@
+//
+//  KeyNumbers.cpp
+//  FMCalculator
+//
+//  Converts spectrum frequencies to equal-tempered key numbers and cents.
+//
+//
+
+#include "KeyNumbers.h"
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+ #include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define FM_KEYNUMBERS_SSE2 1
+#endif
+
+const int KeyNumbers::invalidKey = INT_MIN;
+
+/*  Every path computes, for f = 2^e * m with m in [sqrt(1/2), sqrt(2)),
+
+        log2(m) = t * (c1 + c3 t^2 + ... + c13 t^12),  t = (m - 1) / (m + 1)
+
+    (the atanh series, ck = 2 / (k ln 2), |t| < 0.172), then the fractional
+    key x = 12 e + (12 log2(m) + keyOffset), rounds it to the nearest even
+    integer and takes cents = 100 (x - key). The operations and their order
+    are the same in each path, so they agree bit for bit as long as the
+    compiler does not fuse a multiply and an add into one FMA in some paths
+    and not others. Contraction is switched off for this file: by the pragma
+    below for Clang, and by -ffp-contract=off in the Linux Makefile for GCC.
+*/
+#if defined(__clang__)
+ #pragma STDC FP_CONTRACT OFF
+#endif
+static const double sqrt2 = 1.4142135623730951;
+static const double keyOffset = 69.0 - 12.0 * 8.78135971352466;   // 69 - 12 log2(440)
+static const double c1 = 2.8853900817779268, c3 = 0.9617966939259757, c5 = 0.5770780163555853,
+                    c7 = 0.41219858311113244, c9 = 0.3205988979753252, c11 = 0.2623081892525388,
+                    c13 = 0.2219530832136867;
+
+static void convertScalar(double f, int& key, float& cents)
+{
+		if (!(f >= DBL_MIN && f <= DBL_MAX))
+		{
+				key = KeyNumbers::invalidKey;
+				cents = 0.0f;
+				return;
+		}
+		
+		uint64_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		double e = (double)(int)(bits >> 52) - 1023.0;
+		bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+		double m;
+		memcpy(&m, &bits, sizeof(m));
+		if (m > sqrt2)
+		{
+				m = m * 0.5;
+				e = e + 1.0;
+		}
+		
+		double t = (m - 1.0) / (m + 1.0);
+		double t2 = t * t;
+		double p = c13;
+		p = p * t2 + c11;
+		p = p * t2 + c9;
+		p = p * t2 + c7;
+		p = p * t2 + c5;
+		p = p * t2 + c3;
+		p = p * t2 + c1;
+		double x = e * 12.0 + (t * p * 12.0 + keyOffset);
+		
+		double rounded = std::nearbyint(x);
+		key = (int)rounded;
+		cents = (float)((x - rounded) * 100.0);
+}
+
+#if FM_KEYNUMBERS_SSE2
+static void convertSSE2(const double* frequencies, int* keys, float* cents)
+{
+		const __m128d f = _mm_loadu_pd(frequencies);
+		const __m128d one = _mm_set1_pd(1.0);
+		const __m128d valid = _mm_and_pd(_mm_cmpge_pd(f, _mm_set1_pd(DBL_MIN)),
+		                                 _mm_cmple_pd(f, _mm_set1_pd(DBL_MAX)));
+		
+		// The biased exponent, made exact as a double by placing it in the
+		// mantissa of 2^52.
+		__m128i bits = _mm_castpd_si128(f);
+		__m128d e = _mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(bits, 52),
+		                                          _mm_set1_epi64x(0x4330000000000000LL)));
+		e = _mm_sub_pd(e, _mm_set1_pd(4503599627370496.0 + 1023.0));
+		__m128d m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi64x(0x000fffffffffffffLL)),
+		                                          _mm_set1_epi64x(0x3ff0000000000000LL)));
+		
+		const __m128d high = _mm_cmpgt_pd(m, _mm_set1_pd(sqrt2));
+		m = _mm_mul_pd(m, _mm_or_pd(_mm_and_pd(high, _mm_set1_pd(0.5)), _mm_andnot_pd(high, one)));
+		e = _mm_add_pd(e, _mm_and_pd(high, one));
+		
+		const __m128d t = _mm_div_pd(_mm_sub_pd(m, one), _mm_add_pd(m, one));
+		const __m128d t2 = _mm_mul_pd(t, t);
+		__m128d p = _mm_set1_pd(c13);
+		p = _mm_add_pd(_mm_mul_pd(p, t2), _mm_set1_pd(c11));
+		p = _mm_add_pd(_mm_mul_pd(p, t2), _mm_set1_pd(c9));
+		p = _mm_add_pd(_mm_mul_pd(p, t2), _mm_set1_pd(c7));
+		p = _mm_add_pd(_mm_mul_pd(p, t2), _mm_set1_pd(c5));
+		p = _mm_add_pd(_mm_mul_pd(p, t2), _mm_set1_pd(c3));
+		p = _mm_add_pd(_mm_mul_pd(p, t2), _mm_set1_pd(c1));
+		const __m128d twelve = _mm_set1_pd(12.0);
+		const __m128d x = _mm_add_pd(_mm_mul_pd(e, twelve),
+		                             _mm_add_pd(_mm_mul_pd(_mm_mul_pd(t, p), twelve), _mm_set1_pd(keyOffset)));
+		
+		// Rounds to nearest even under the default MXCSR mode, like nearbyint.
+		__m128i key = _mm_cvtpd_epi32(x);
+		__m128d c = _mm_mul_pd(_mm_sub_pd(x, _mm_cvtepi32_pd(key)), _mm_set1_pd(100.0));
+		
+		const __m128i validKeys = _mm_shuffle_epi32(_mm_castpd_si128(valid), _MM_SHUFFLE(3, 3, 2, 0));
+		key = _mm_or_si128(_mm_and_si128(validKeys, key),
+		                   _mm_andnot_si128(validKeys, _mm_set1_epi32(KeyNumbers::invalidKey)));
+		c = _mm_and_pd(valid, c);
+		
+		_mm_storel_epi64((__m128i*)keys, key);
+		_mm_storel_pi((__m64*)cents, _mm_cvtpd_ps(c));
+}
+#endif
+
+#if defined(__AVX2__)
+static void convertAVX2(const double* frequencies, int* keys, float* cents)
+{
+		const __m256d f = _mm256_loadu_pd(frequencies);
+		const __m256d one = _mm256_set1_pd(1.0);
+		const __m256d valid = _mm256_and_pd(_mm256_cmp_pd(f, _mm256_set1_pd(DBL_MIN), _CMP_GE_OQ),
+		                                    _mm256_cmp_pd(f, _mm256_set1_pd(DBL_MAX), _CMP_LE_OQ));
+		
+		__m256i bits = _mm256_castpd_si256(f);
+		__m256d e = _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52),
+		                                                _mm256_set1_epi64x(0x4330000000000000LL)));
+		e = _mm256_sub_pd(e, _mm256_set1_pd(4503599627370496.0 + 1023.0));
+		__m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffffLL)),
+		                                                _mm256_set1_epi64x(0x3ff0000000000000LL)));
+		
+		const __m256d high = _mm256_cmp_pd(m, _mm256_set1_pd(sqrt2), _CMP_GT_OQ);
+		m = _mm256_mul_pd(m, _mm256_blendv_pd(one, _mm256_set1_pd(0.5), high));
+		e = _mm256_add_pd(e, _mm256_and_pd(high, one));
+		
+		const __m256d t = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+		const __m256d t2 = _mm256_mul_pd(t, t);
+		__m256d p = _mm256_set1_pd(c13);
+		p = _mm256_add_pd(_mm256_mul_pd(p, t2), _mm256_set1_pd(c11));
+		p = _mm256_add_pd(_mm256_mul_pd(p, t2), _mm256_set1_pd(c9));
+		p = _mm256_add_pd(_mm256_mul_pd(p, t2), _mm256_set1_pd(c7));
+		p = _mm256_add_pd(_mm256_mul_pd(p, t2), _mm256_set1_pd(c5));
+		p = _mm256_add_pd(_mm256_mul_pd(p, t2), _mm256_set1_pd(c3));
+		p = _mm256_add_pd(_mm256_mul_pd(p, t2), _mm256_set1_pd(c1));
+		const __m256d twelve = _mm256_set1_pd(12.0);
+		const __m256d x = _mm256_add_pd(_mm256_mul_pd(e, twelve),
+		                                _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(t, p), twelve), _mm256_set1_pd(keyOffset)));
+		
+		__m128i key = _mm256_cvtpd_epi32(x);
+		__m256d c = _mm256_mul_pd(_mm256_sub_pd(x, _mm256_cvtepi32_pd(key)), _mm256_set1_pd(100.0));
+		
+		const __m128i validKeys = _mm256_cvtpd_epi32(_mm256_and_pd(valid, one));
+		key = _mm_blendv_epi8(_mm_set1_epi32(KeyNumbers::invalidKey), key, _mm_cmpeq_epi32(validKeys, _mm_set1_epi32(1)));
+		c = _mm256_and_pd(valid, c);
+		
+		_mm_storeu_si128((__m128i*)keys, key);
+		_mm_storeu_ps(cents, _mm256_cvtpd_ps(c));
+}
+#endif
+
+void KeyNumbers::fromFrequencies(const double* frequencies, size_t count,
+                                 int* keys, float* cents)
+{
+		size_t i = 0;
+#if defined(__AVX2__)
+		for (; i + 4 <= count; i += 4)
+				convertAVX2(frequencies + i, keys + i, cents + i);
+#endif
+#if FM_KEYNUMBERS_SSE2
+		for (; i + 2 <= count; i += 2)
+				convertSSE2(frequencies + i, keys + i, cents + i);
+#endif
+		for (; i < count; i++)
+				convertScalar(frequencies[i], keys[i], cents[i]);
+}
+
+menc::Note KeyNumbers::toNote(int key, float cents)
+{
+		// Note(int) would mark an out of range key valid again.
+		menc::Note note;
+		note.fromMIDIKeyNumber(key, false);
+		if (note.valid())
+				note.semitoneTuning(cents / 100.0f);
+		return note;
+}
+
+std::string KeyNumbers::toName(int key, float cents)
+{
+		return toNote(key, cents).toPrettyName();
+}
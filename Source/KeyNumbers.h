@@ -0,0 +1,45 @@
+//
+//  KeyNumbers.h
+//  FMCalculator
+//
+//  Converts spectrum frequencies to equal-tempered key numbers and cents.
+//
+//
+
+#ifndef __FMCalculator__KeyNumbers__
+#define __FMCalculator__KeyNumbers__
+
+#include <stddef.h>
+#include <string>
+#include "../menc/menc.h"
+
+/** Maps frequencies to the nearest MIDI key number (A4 = 440 Hz = 69) and
+    the deviation from it in cents, -50 to 50.
+
+    fromFrequencies works on whole buffers with AVX2 or SSE2 when the
+    compiler targets them and plain code otherwise. All paths evaluate the
+    same log2 approximation, accurate to about 1e-12 cents before the cents
+    are rounded to float, and give the same results. menc Notes and their
+    names are only built on demand from the buffers with toNote and toName.
+*/
+class KeyNumbers
+{
+public:
+		/** The key given for frequencies that are not positive and finite. */
+		static const int invalidKey;
+
+		/** Writes the nearest key and its cents deviation for each frequency.
+		    Invalid frequencies get invalidKey and 0 cents. */
+		static void fromFrequencies(const double* frequencies, size_t count,
+		                            int* keys, float* cents);
+
+		/** The Note for a key and cents deviation, spelled with flats as
+		    Note::fromFrequency spells it and tuned to the nearest eighth
+		    tone. Keys outside 0..127 give an invalid note. */
+		static menc::Note toNote(int key, float cents);
+
+		/** The menc pretty name (e.g. "Eb4") of toNote(key, cents). */
+		static std::string toName(int key, float cents);
+};
+
+#endif /* defined(__FMCalculator__KeyNumbers__) */
@@ -6,36 +6,33 @@
   ==============================================================================
 */
 
-#include "FM.h"
 #include "MainComponent.h"
-#include "../menc/menc.h"
 
 
 
-String arrayToString(Array<double> array)
+static std::string getDefaultBesselTablePath()
 {
-		String outputString;
-		for (int i=0; i<array.size(); i++) {
-				outputString += String(array[i]) += ", ";
-		}
-		return outputString;
+		File file = File::getSpecialLocation(File::userApplicationDataDirectory)
+		                .getChildFile("FMCalculator").getChildFile("BesselTable.bin");
+		if (! file.existsAsFile() && file.getParentDirectory().createDirectory().wasOk())
+				BesselTable::generate(file.getFullPathName().toStdString(), BesselTable::defaultMaxIndex,
+				                      BesselTable::defaultMaxOrder, BesselTable::defaultAccuracy);
+		return file.getFullPathName().toStdString();
 }
 
-String arrayToNoteNameString(Array<double> array)
+/** The Bessel table in the user's application data folder, mapped on first
+    use. The first run generates it with the default size and accuracy (a
+    few milliseconds); nullptr if it can be neither written nor mapped. */
+static const BesselTable* getDefaultBesselTable()
 {
-		StringArray outputString;
-		menc::Note myNote;
-		for (int i=0; i<array.size();i++){
-				myNote.fromFrequency((float)array[i]);
-				outputString.addIfNotAlreadyThere(myNote.toPrettyString());
-		}
-		return outputString.joinIntoString(",  ");
+		static BesselTable table(getDefaultBesselTablePath());
+		return table.isValid() ? &table : nullptr;
 }
 
 
 
 //==============================================================================
-MainContentComponent::MainContentComponent() : carrierSlider(Slider::LinearHorizontal, Slider::TextBoxRight), cmRatioSlider(Slider::LinearHorizontal, Slider::TextBoxRight), indexSlider(Slider::LinearHorizontal, Slider::TextBoxRight)
+MainContentComponent::MainContentComponent() : carrierSlider(Slider::LinearHorizontal, Slider::TextBoxRight), cmRatioSlider(Slider::LinearHorizontal, Slider::TextBoxRight), indexSlider(Slider::LinearHorizontal, Slider::TextBoxRight), worker(*this, getDefaultBesselTable())
 {
 		addAndMakeVisible(&carrierLabel);
 		
@@ -111,14 +108,15 @@ void MainContentComponent::resized()
 void MainContentComponent::sliderValueChanged(Slider* slider)
 {
 		if (&carrierSlider == slider || &cmRatioSlider == slider || &indexSlider == slider) {
-				String outputString, outputNoteNameString;
-				FM myFM (carrierSlider.getValue(), cmRatioSlider.getValue(), indexSlider.getValue());
-				//myFM.runFM();
-				outputString = arrayToString(myFM.getSpectrum());
-				outcome.setText(outputString, sendNotification);
-				
-				outputNoteNameString = arrayToNoteNameString(myFM.getSpectrum());
-				noteNameOutcome.setText(outputNoteNameString, sendNotification);
+				// The worker coalesces a drag into its latest value and calls
+				// spectrumComputed once the text is ready.
+				worker.request(carrierSlider.getValue(), cmRatioSlider.getValue(), indexSlider.getValue());
 		}
 
+}
+
+void MainContentComponent::spectrumComputed(const String& spectrum, const String& noteNames)
+{
+		outcome.setText(spectrum, sendNotification);
+		noteNameOutcome.setText(noteNames, sendNotification);
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 #define MAINCOMPONENT_H_INCLUDED
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "SpectrumWorker.h"
 
 
 //==============================================================================
@@ -17,7 +18,7 @@
     This component lives inside our window, and this is where you should put all
     your controls and content.
 */
-class MainContentComponent   : public Component, public Slider::Listener
+class MainContentComponent   : public Component, public Slider::Listener, public SpectrumWorker::Listener
 {
 public:
     //==============================================================================
@@ -26,6 +27,7 @@ public:
 
 		void sliderValueChanged(Slider*);
 		void labelTextChanged(Label*);
+		void spectrumComputed(const String& spectrum, const String& noteNames);
     void paint (Graphics&);
     void resized();
 
@@ -45,6 +47,8 @@ private:
 		
 		Label noteNameLabel;
 		Label noteNameOutcome;
+		
+		SpectrumWorker worker;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainContentComponent)
 };
 
@@ -0,0 +1,96 @@
+//
+//  NoteNames.cpp
+//  FMCalculator
+//
+//  Converts spectrum frequencies to menc note names.
+//
+//
+
+#include "NoteNames.h"
+#include <algorithm>
+#include "../menc/menc.h"
+#include "PitchSet.h"
+
+/** Whether a note is the first with its name: a valid note's name depends
+    only on its key, so keys already named are kept in a PitchSet instead of
+    comparing strings. */
+static bool isFirstName(menc::Note& note, PitchSet& added, bool& addedInvalid)
+{
+		if (!note.valid())
+		{
+				if (addedInvalid)
+						return false;
+				addedInvalid = true;
+				return true;
+		}
+		
+		int key = note.toMIDIKeyNumber();
+		if (added.contains(key))
+				return false;
+		added.insert(key);
+		return true;
+}
+
+void NoteNames::fromFrequencies(const double* frequencies, size_t count,
+                                std::vector<std::string>& names)
+{
+		// Converted by one reused Note, as the GUI always has.
+		menc::Note note;
+		
+		// Only names the caller passed in are searched for.
+		const size_t numExisting = names.size();
+		PitchSet added;
+		bool addedInvalid = false;
+		for (size_t i=0; i<count; i++)
+		{
+				note.fromFrequency((float)frequencies[i]);
+				if (!isFirstName(note, added, addedInvalid))
+						continue;
+		
+				const char* name = note.toPrettyName();
+				if (std::find(names.begin(), names.begin() + numExisting, name) == names.begin() + numExisting)
+						names.push_back(name);
+		}
+}
+
+/** Appends text to buffer[length..], keeping room for the terminator. */
+static void append(char* buffer, size_t size, size_t& length, const char* text)
+{
+		for (; *text != 0 && length + 1 < size; text++)
+				buffer[length++] = *text;
+}
+
+size_t NoteNames::write(const double* frequencies, size_t count, char* buffer, size_t size)
+{
+		if (size == 0)
+				return 0;
+		
+		menc::Note note;
+		PitchSet added;
+		bool addedInvalid = false;
+		size_t length = 0;
+		for (size_t i=0; i<count; i++)
+		{
+				note.fromFrequency((float)frequencies[i]);
+				if (!isFirstName(note, added, addedInvalid))
+						continue;
+		
+				if (length > 0)
+						append(buffer, size, length, ",  ");
+				append(buffer, size, length, note.toPrettyName());
+		}
+		buffer[length] = 0;
+		return length;
+}
+
+std::string NoteNames::toString(const double* frequencies, size_t count)
+{
+		char buffer[maxTextLength + 1];
+		size_t length = write(frequencies, count, buffer, sizeof(buffer));
+		return std::string(buffer, length);
+}
+
+std::string NoteNames::toString(const std::vector<double>& frequencies)
+{
+		return toString(frequencies.data(), frequencies.size());
+}
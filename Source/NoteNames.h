@@ -0,0 +1,41 @@
+//
+//  NoteNames.h
+//  FMCalculator
+//
+//  Converts spectrum frequencies to menc note names.
+//
+//
+
+#ifndef __FMCalculator__NoteNames__
+#define __FMCalculator__NoteNames__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/** The frequency to note name conversion shown under the spectrum, kept
+    apart from the GUI so headless tools produce exactly the same names. */
+class NoteNames
+{
+public:
+		/** Appends the menc pretty name (e.g. "Eb4") of each frequency to names,
+		    skipping names that are already there. */
+		static void fromFrequencies(const double* frequencies, size_t count,
+		                            std::vector<std::string>& names);
+		
+		/** The longest text write can give: all 128 keys and "invalid", each
+		    at most 11 characters, joined by ",  ". */
+		static const size_t maxTextLength = 129 * (11 + 3);
+		
+		/** Writes the distinct note names of a spectrum joined by ",  " into
+		    buffer, cutting them off at size - 1 characters, and terminates them.
+		    Returns the number of characters written. The names come from
+		    menc's interned table, so nothing is allocated. */
+		static size_t write(const double* frequencies, size_t count, char* buffer, size_t size);
+		
+		/** The distinct note names of a spectrum joined by ",  ". */
+		static std::string toString(const double* frequencies, size_t count);
+		static std::string toString(const std::vector<double>& frequencies);
+};
+
+#endif /* defined(__FMCalculator__NoteNames__) */
@@ -0,0 +1,66 @@
+//
+//  PitchSet.cpp
+//  FMCalculator
+//
+//  The set of MIDI keys sounding in a spectrum, as a 128-bit bitmap.
+//
+//
+
+#include "PitchSet.h"
+#include <algorithm>
+#include "KeyNumbers.h"
+
+// Bits 0, 12, ... 60: every C among keys 0..63.
+static const uint64_t everyOctave = 0x1001001001001001ULL;
+
+PitchSet PitchSet::fromSpectrum(const double* frequencies, size_t count)
+{
+		PitchSet set;
+		int keys[256];
+		float cents[256];
+		for (size_t start = 0; start < count; start += 256)
+		{
+				size_t n = std::min(count - start, (size_t)256);
+				KeyNumbers::fromFrequencies(frequencies + start, n, keys, cents);
+				for (size_t i=0; i<n; i++)
+						set.insert(keys[i]);
+		}
+		return set;
+}
+
+PitchSet PitchSet::fromSpectrum(const std::vector<double>& frequencies)
+{
+		return fromSpectrum(frequencies.data(), frequencies.size());
+}
+
+uint16_t PitchSet::getPitchClasses() const
+{
+		// Key 64 is an E, so the high word's Cs start 8 bits in.
+		uint16_t pitchClasses = 0;
+		for (int pc=0; pc<12; pc++)
+		{
+				if ((_low & (everyOctave << pc)) != 0 || (_high & (everyOctave << ((pc + 8) % 12))) != 0)
+						pitchClasses |= (uint16_t)(1 << pc);
+		}
+		return pitchClasses;
+}
+
+uint16_t PitchSet::transposePitchClasses(uint16_t pitchClasses, int semitones)
+{
+		int n = ((semitones % 12) + 12) % 12;
+		return (uint16_t)(((pitchClasses << n) | (pitchClasses >> (12 - n))) & 0xfff);
+}
+
+std::string PitchSet::toString() const
+{
+		std::string joined;
+		for (int key=0; key<numKeys; key++)
+		{
+				if (!contains(key))
+						continue;
+				if (!joined.empty())
+						joined += ",  ";
+				joined += KeyNumbers::toNote(key, 0.0f).toPrettyName();
+		}
+		return joined;
+}
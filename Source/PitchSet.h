@@ -0,0 +1,134 @@
+//
+//  PitchSet.h
+//  FMCalculator
+//
+//  The set of MIDI keys sounding in a spectrum, as a 128-bit bitmap.
+//
+//
+
+#ifndef __FMCalculator__PitchSet__
+#define __FMCalculator__PitchSet__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+ #include <intrin.h>
+#endif
+
+/** The MIDI keys 0..127 a spectrum sounds, one bit each, so spectra can be
+    compared with a few word operations instead of by their note names.
+
+    Sets are built from spectra with fromSpectrum and only turned into names
+    at the end with toString, which lists the keys in ascending order with
+    the spelling NoteNames uses.
+*/
+class PitchSet
+{
+public:
+		static const int numKeys = 128;
+		
+		PitchSet()
+		: _low(0), _high(0)
+		{
+		}
+		
+		/** The set of keys nearest to the frequencies, as KeyNumbers rounds
+		    them. Frequencies outside keys 0..127 are left out. */
+		static PitchSet fromSpectrum(const double* frequencies, size_t count);
+		static PitchSet fromSpectrum(const std::vector<double>& frequencies);
+		
+		bool contains(int key) const
+		{
+				if (key < 0 || key >= numKeys)
+						return false;
+				return ((key < 64 ? _low >> key : _high >> (key - 64)) & 1) != 0;
+		}
+		
+		void insert(int key)
+		{
+				if (key < 0 || key >= numKeys)
+						return;
+				if (key < 64)
+						_low |= (uint64_t)1 << key;
+				else
+						_high |= (uint64_t)1 << (key - 64);
+		}
+		
+		void remove(int key)
+		{
+				if (key < 0 || key >= numKeys)
+						return;
+				if (key < 64)
+						_low &= ~((uint64_t)1 << key);
+				else
+						_high &= ~((uint64_t)1 << (key - 64));
+		}
+		
+		bool isEmpty() const { return (_low | _high) == 0; }
+		int size() const { return popcount(_low) + popcount(_high); }
+		
+		PitchSet operator|(const PitchSet& other) const { return PitchSet(_low | other._low, _high | other._high); }
+		PitchSet operator&(const PitchSet& other) const { return PitchSet(_low & other._low, _high & other._high); }
+		PitchSet& operator|=(const PitchSet& other) { _low |= other._low; _high |= other._high; return *this; }
+		PitchSet& operator&=(const PitchSet& other) { _low &= other._low; _high &= other._high; return *this; }
+		bool operator==(const PitchSet& other) const { return _low == other._low && _high == other._high; }
+		bool operator!=(const PitchSet& other) const { return !(*this == other); }
+		
+		/** |A and B| / |A or B|, or 1 when both sets are empty. */
+		double jaccard(const PitchSet& other) const
+		{
+				int unionSize = (*this | other).size();
+				return unionSize == 0 ? 1.0 : (double)(*this & other).size() / unionSize;
+		}
+		
+		/** The set moved up (or down, for negative semitones) by a number of
+		    keys. Keys moved outside 0..127 are dropped. */
+		PitchSet transposed(int semitones) const
+		{
+				if (semitones >= numKeys || semitones <= -numKeys)
+						return PitchSet();
+				if (semitones >= 64)
+						return PitchSet(0, _low << (semitones - 64));
+				if (semitones <= -64)
+						return PitchSet(_high >> (-semitones - 64), 0);
+				if (semitones > 0)
+						return PitchSet(_low << semitones, (_high << semitones) | (_low >> (64 - semitones)));
+				if (semitones < 0)
+						return PitchSet((_low >> -semitones) | (_high << (64 + semitones)), _high >> -semitones);
+				return *this;
+		}
+		
+		/** The pitch classes of the set, bit 0 for C up to bit 11 for B. */
+		uint16_t getPitchClasses() const;
+		
+		/** A pitch-class mask rotated up by a number of semitones. */
+		static uint16_t transposePitchClasses(uint16_t pitchClasses, int semitones);
+		
+		uint64_t getLowKeys() const { return _low; }        // keys 0..63
+		uint64_t getHighKeys() const { return _high; }      // keys 64..127
+		
+		/** The names of the keys, lowest first, joined by ",  ". */
+		std::string toString() const;
+
+private:
+		PitchSet(uint64_t low, uint64_t high)
+		: _low(low), _high(high)
+		{
+		}
+		
+		static int popcount(uint64_t bits)
+		{
+#if defined(_MSC_VER)
+				return (int)__popcnt64(bits);
+#else
+				return __builtin_popcountll(bits);
+#endif
+		}
+		
+		uint64_t _low, _high;
+};
+
+#endif /* defined(__FMCalculator__PitchSet__) */
@@ -0,0 +1,77 @@
+//
+//  SetClassAnalysis.cpp
+//  FMCalculator
+//
+//  Names the pitch-class set class of FM spectra.
+//
+//
+
+#include "SetClassAnalysis.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "FMBatch.h"
+#include "PitchSet.h"
+
+/** State shared by the worker threads of one SetClassAnalysis::fromBatch. */
+struct Annotation
+{
+		const FMBatch* batch;
+		uint16_t* pitchClasses;
+		menc::SetClass* classes;
+		size_t count, rangeSize;
+		std::atomic<size_t> nextRange;
+};
+
+static void runAnnotation(Annotation* annotation)
+{
+		const FMBatch& batch = *annotation->batch;
+		
+		for (;;)
+		{
+				size_t start = annotation->nextRange++ * annotation->rangeSize;
+				if (start >= annotation->count)
+						return;
+				
+				size_t end = std::min(annotation->count, start + annotation->rangeSize);
+				for (size_t i = start; i < end; i++)
+						annotation->pitchClasses[i] = PitchSet::fromSpectrum(batch.getSpectrum(i),
+						                                                     batch.getSpectrumSize(i)).getPitchClasses();
+				menc::SetClasses::fromPitchClasses(annotation->pitchClasses + start, (int)(end - start),
+				                                   annotation->classes + start);
+		}
+}
+
+const menc::SetClass& SetClassAnalysis::fromSpectrum(const double* frequencies, size_t count)
+{
+		return menc::SetClasses::fromPitchClasses(PitchSet::fromSpectrum(frequencies, count).getPitchClasses());
+}
+
+void SetClassAnalysis::fromBatch(const FMBatch& batch, std::vector<uint16_t>& pitchClasses,
+                                 std::vector<menc::SetClass>& classes, int numThreads)
+{
+		if (numThreads <= 0)
+				numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+		
+		size_t count = batch.getNumSpectra();
+		pitchClasses.resize(count);
+		classes.resize(count);
+		
+		// Build the table before the workers race to do it.
+		menc::SetClasses::fromPitchClasses(0);
+		
+		Annotation annotation;
+		annotation.batch = &batch;
+		annotation.pitchClasses = pitchClasses.data();
+		annotation.classes = classes.data();
+		annotation.count = count;
+		annotation.rangeSize = 1024;
+		annotation.nextRange = 0;
+		
+		std::vector<std::thread> threads;
+		for (int t = 1; t < numThreads && (size_t)t * annotation.rangeSize < count; t++)
+				threads.push_back(std::thread(runAnnotation, &annotation));
+		runAnnotation(&annotation);
+		for (size_t t = 0; t < threads.size(); t++)
+				threads[t].join();
+}
@@ -0,0 +1,39 @@
+//
+//  SetClassAnalysis.h
+//  FMCalculator
+//
+//  Names the pitch-class set class of FM spectra.
+//
+//
+
+#ifndef __FMCalculator__SetClassAnalysis__
+#define __FMCalculator__SetClassAnalysis__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "../menc/menc.h"
+
+class FMBatch;
+
+/** Classifies spectra by the set class of the pitch classes they sound
+    (keys as KeyNumbers rounds them, folded into one octave).
+
+    The prime form, interval vector, Forte number and Z partner of every
+    pitch-class set come from the menc::SetClasses table, so once the keys
+    are known each spectrum costs one table load.
+*/
+class SetClassAnalysis
+{
+public:
+		/** The set class of one spectrum. */
+		static const menc::SetClass& fromSpectrum(const double* frequencies, size_t count);
+		
+		/** Classifies every spectrum of a sweep into classes, one entry per
+		    spectrum, with the pitch-class masks left in pitchClasses. If
+		    numThreads is 0 one worker per CPU is used. */
+		static void fromBatch(const FMBatch& batch, std::vector<uint16_t>& pitchClasses,
+		                      std::vector<menc::SetClass>& classes, int numThreads = 0);
+};
+
+#endif /* defined(__FMCalculator__SetClassAnalysis__) */
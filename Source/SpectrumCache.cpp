@@ -0,0 +1,106 @@
+//
+//  SpectrumCache.cpp
+//  FMCalculator
+//
+//  Remembers recently shown spectra and their formatted text.
+//
+//
+
+#include "SpectrumCache.h"
+#include <cmath>
+
+const double SpectrumCache::quantum = 1e-6;
+
+SpectrumCache::Key::Key(double c, double r, double i)
+: carrier(std::llround(c / quantum)), cmRatio(std::llround(r / quantum)), index(std::llround(i / quantum))
+{
+}
+
+double SpectrumCache::Key::getCarrier() const
+{
+		return carrier * quantum;
+}
+
+double SpectrumCache::Key::getCMRatio() const
+{
+		return cmRatio * quantum;
+}
+
+double SpectrumCache::Key::getIndex() const
+{
+		return index * quantum;
+}
+
+bool SpectrumCache::Key::operator<(const Key& other) const
+{
+		if (carrier != other.carrier)
+				return carrier < other.carrier;
+		if (cmRatio != other.cmRatio)
+				return cmRatio < other.cmRatio;
+		return index < other.index;
+}
+
+SpectrumCache::SpectrumCache(size_t capacity)
+: _capacity(jmax((size_t)1, capacity)), _hits(0), _misses(0)
+{
+}
+
+const CachedSpectrum* SpectrumCache::find(const Key& key)
+{
+		std::map<Key, Entries::iterator>::iterator position = _positions.find(key);
+		if (position == _positions.end())
+		{
+				++_misses;
+				return nullptr;
+		}
+		
+		++_hits;
+		_entries.splice(_entries.begin(), _entries, position->second);
+		return &position->second->second;
+}
+
+void SpectrumCache::insert(const Key& key, const CachedSpectrum& entry)
+{
+		std::map<Key, Entries::iterator>::iterator position = _positions.find(key);
+		if (position != _positions.end())
+		{
+				position->second->second = entry;
+				_entries.splice(_entries.begin(), _entries, position->second);
+				return;
+		}
+		
+		if (_entries.size() >= _capacity)
+		{
+				_positions.erase(_entries.back().first);
+				_entries.pop_back();
+		}
+		
+		_entries.push_front(std::make_pair(key, entry));
+		_positions[key] = _entries.begin();
+}
+
+void SpectrumCache::clear()
+{
+		_entries.clear();
+		_positions.clear();
+}
+
+size_t SpectrumCache::size() const
+{
+		return _entries.size();
+}
+
+size_t SpectrumCache::getCapacity() const
+{
+		return _capacity;
+}
+
+uint64 SpectrumCache::getHits() const
+{
+		return _hits;
+}
+
+uint64 SpectrumCache::getMisses() const
+{
+		return _misses;
+}
@@ -0,0 +1,85 @@
+//
+//  SpectrumCache.h
+//  FMCalculator
+//
+//  Remembers recently shown spectra and their formatted text.
+//
+//
+
+#ifndef __FMCalculator__SpectrumCache__
+#define __FMCalculator__SpectrumCache__
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <vector>
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/** The spectrum of one slider position and the text shown for it. */
+struct CachedSpectrum
+{
+		std::vector<double> spectrum;
+		String spectrumText;
+		String noteNameText;
+};
+
+/** A bounded least-recently-used cache of spectra, so scrubbing the sliders
+    back over positions already visited costs a lookup instead of a full
+    FM::runFM and formatting pass.
+
+    Parameters are quantized to multiples of quantum before they are used as
+    a key; callers should compute from the quantized values (see Key) so a
+    cached entry is exactly what a fresh computation would give.
+
+    find and insert are meant to be called from one thread. The hit and miss
+    counters may be read from any thread.
+*/
+class SpectrumCache
+{
+public:
+		static const double quantum;
+		
+		struct Key
+		{
+				Key(double carrier, double cmratio, double index);
+		
+				double getCarrier() const;
+				double getCMRatio() const;
+				double getIndex() const;
+		
+				bool operator<(const Key& other) const;
+		
+				int64 carrier, cmRatio, index;
+		};
+		
+		explicit SpectrumCache(size_t capacity = 256);
+		
+		/** Returns the entry for key and marks it most recently used, or nullptr.
+		    The pointer stays valid until the next insert or clear. */
+		const CachedSpectrum* find(const Key& key);
+		
+		/** Stores entry under key, evicting the least recently used entry if
+		    the cache is full. */
+		void insert(const Key& key, const CachedSpectrum& entry);
+		
+		void clear();
+		
+		size_t size() const;
+		size_t getCapacity() const;
+		uint64 getHits() const;
+		uint64 getMisses() const;
+
+private:
+		typedef std::list<std::pair<Key, CachedSpectrum> > Entries;
+		
+		size_t _capacity;
+		Entries _entries;                           // most recently used first
+		std::map<Key, Entries::iterator> _positions;
+		
+		std::atomic<uint64> _hits;
+		std::atomic<uint64> _misses;
+		
+		JUCE_DECLARE_NON_COPYABLE (SpectrumCache)
+};
+
+#endif /* defined(__FMCalculator__SpectrumCache__) */
@@ -0,0 +1,136 @@
+//
+//  SpectrumWorker.cpp
+//  FMCalculator
+//
+//  Computes and formats FM spectra on a background thread.
+//
+//
+
+#include "SpectrumWorker.h"
+#include "NoteNames.h"
+
+static String arrayToString(const std::vector<double>& array)
+{
+		String outputString;
+		for (size_t i=0; i<array.size(); i++) {
+				outputString += String(array[i]) += ", ";
+		}
+		return outputString;
+}
+
+static String arrayToNoteNameString(const std::vector<double>& array)
+{
+		// Only the JUCE String itself is allocated; the names are written
+		// straight from menc's table.
+		char buffer[NoteNames::maxTextLength + 1];
+		size_t length = NoteNames::write(array.data(), array.size(), buffer, sizeof(buffer));
+		return String(buffer, length);
+}
+
+SpectrumWorker::SpectrumWorker(Listener& listener, const BesselTable* table)
+: Thread("FM Spectrum"), _listener(listener), _fm(100.0, 1.0, 1.0, table),
+  _computedGeneration(0), _generation(0), _carrier(100.0), _cmRatio(1.0), _index(1.0)
+{
+		startThread();
+}
+
+SpectrumWorker::~SpectrumWorker()
+{
+		stopThread(4000);
+		cancelPendingUpdate();
+}
+
+void SpectrumWorker::request(double carrier, double cmratio, double index)
+{
+		{
+				const ScopedLock sl(_lock);
+				_carrier = carrier;
+				_cmRatio = cmratio;
+				_index = index;
+				++_generation;
+		}
+		notify();
+}
+
+bool SpectrumWorker::isStale(int generation) const
+{
+		return generation != _generation.get() || threadShouldExit();
+}
+
+const SpectrumCache& SpectrumWorker::getCache() const
+{
+		return _cache;
+}
+
+void SpectrumWorker::publish(const CachedSpectrum& result)
+{
+		{
+				const ScopedLock sl(_lock);
+				_spectrumText = result.spectrumText;
+				_noteNameText = result.noteNameText;
+		}
+		triggerAsyncUpdate();
+}
+
+void SpectrumWorker::run()
+{
+		while (!threadShouldExit())
+		{
+				int generation;
+				double carrier, cmratio, index;
+				{
+						const ScopedLock sl(_lock);
+						generation = _generation.get();
+						carrier = _carrier;
+						cmratio = _cmRatio;
+						index = _index;
+				}
+		
+				if (generation == _computedGeneration)
+				{
+						wait(-1);
+						continue;
+				}
+				_computedGeneration = generation;
+		
+				const SpectrumCache::Key key(carrier, cmratio, index);
+				if (const CachedSpectrum* cached = _cache.find(key))
+				{
+						publish(*cached);
+						continue;
+				}
+		
+				// Only the changed parameters are invalidated, so carrier and ratio
+				// drags reuse the Bessel values computed for the current index.
+				_fm.setCarrier(key.getCarrier());
+				_fm.setCMRatio(key.getCMRatio());
+				_fm.setIndex(key.getIndex());
+				_fm.runFM();
+				if (isStale(generation))
+						continue;
+		
+				CachedSpectrum result;
+				result.spectrum = _fm.getSpectrum();
+				result.spectrumText = arrayToString(result.spectrum);
+				if (isStale(generation))
+						continue;
+		
+				result.noteNameText = arrayToNoteNameString(result.spectrum);
+				if (isStale(generation))
+						continue;
+		
+				_cache.insert(key, result);
+				publish(result);
+		}
+}
+
+void SpectrumWorker::handleAsyncUpdate()
+{
+		String spectrumText, noteNameText;
+		{
+				const ScopedLock sl(_lock);
+				spectrumText = _spectrumText;
+				noteNameText = _noteNameText;
+		}
+		_listener.spectrumComputed(spectrumText, noteNameText);
+}
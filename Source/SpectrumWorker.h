@@ -0,0 +1,72 @@
+//
+//  SpectrumWorker.h
+//  FMCalculator
+//
+//  Computes and formats FM spectra on a background thread.
+//
+//
+
+#ifndef __FMCalculator__SpectrumWorker__
+#define __FMCalculator__SpectrumWorker__
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FM.h"
+#include "SpectrumCache.h"
+
+/** Keeps spectrum work off the message thread.
+
+    request() only records the parameters and wakes the worker, so it never
+    blocks on a computation. Requests that arrive while the worker is busy
+    are coalesced: only the latest parameters are computed, and a job whose
+    parameters have been superseded is abandoned between its steps instead
+    of being formatted and delivered. Finished results are handed to the
+    Listener on the message thread through an AsyncUpdater.
+
+    Parameters are quantized by the SpectrumCache, and positions that were
+    shown recently are served from it without recomputing.
+*/
+class SpectrumWorker : private Thread, private AsyncUpdater
+{
+public:
+		class Listener
+		{
+		public:
+				virtual ~Listener() {}
+		
+				/** Called on the message thread with the latest finished spectrum. */
+				virtual void spectrumComputed(const String& spectrum, const String& noteNames) = 0;
+		};
+		
+		SpectrumWorker(Listener& listener, const BesselTable* table = nullptr);
+		~SpectrumWorker();
+		
+		/** Asks for the spectrum of these parameters, replacing any request
+		    that has not been delivered yet. */
+		void request(double carrier, double cmratio, double index);
+		
+		/** The worker's cache; only its counters may be read from other threads. */
+		const SpectrumCache& getCache() const;
+
+private:
+		void run() override;
+		void handleAsyncUpdate() override;
+		
+		bool isStale(int generation) const;
+		void publish(const CachedSpectrum& result);
+		
+		Listener& _listener;
+		
+		// Only touched by the worker thread.
+		FM _fm;
+		int _computedGeneration;
+		SpectrumCache _cache;
+		
+		CriticalSection _lock;
+		Atomic<int> _generation;
+		double _carrier, _cmRatio, _index;
+		String _spectrumText, _noteNameText;
+		
+		JUCE_DECLARE_NON_COPYABLE (SpectrumWorker)
+};
+
+#endif /* defined(__FMCalculator__SpectrumWorker__) */
@@ -0,0 +1,119 @@
+//
+//  bitfieldbench.cpp
+//  FMCalculator
+//
+//  Times the menc Note field accessors.
+//
+//
+
+/*  bitfieldbench
+
+    Reads and rewrites the letter, accidental, octave and voice of 64K notes
+    200 times, once through the Note accessors (compile-time BitfieldLayouts)
+    and once through LegacyNote, a copy of the Bitfield read/write(index,
+    width) the accessors used before, which built a 33-entry mask table on
+    the stack and looked the mask up in it on every call. It prints the time
+    per note for each. The checksums must match; they keep the loops from
+    being optimised away.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "../menc/menc.h"
+
+using namespace menc;
+
+static const int numNotes = 1 << 16;
+static const int numRepeats = 200;
+
+/** The Note fields on top of the original Bitfield read and write. The
+    field positions are private to Note, so they are repeated here from
+    mencNotes.h. */
+class LegacyNote
+{
+public:
+		LegacyNote() : bits(0) {}
+		explicit LegacyNote(uint32 noteBits) : bits(noteBits) {}
+		
+		int letter() const             { return (int)read(8, 3); }
+		void letter(int value)         { write(8, 3, (uint32)value); }
+		int accidental() const         { return (int)read(5, 3); }
+		void accidental(int value)     { write(5, 3, (uint32)value); }
+		int octave() const             { return (int)read(11, 4) - 1; }
+		void octave(int value)         { write(11, 4, (uint32)(value + 1)); }
+		int voice() const              { return (int)read(15, 2); }
+		void voice(int value)          { write(15, 2, (uint32)(value - 1)); }
+
+private:
+		uint32 bits;
+		
+		void write(uint32 bit_index, uint32 bits_to_take, uint32 value)
+		{
+				uint32 masks[33] = {0, //0
+						1,3,7,15,31,63,127,255, //1-8
+						511,1023,2047,4095,8191,16383,32767,65535, //9-16
+						131071,262143,524287,1048575,2097151,4194303,8388607,16777215, //17-24
+						33554431,67108863,134217727,268435455,536870911,1073741823,2147483647,
+						0xFFFFFFFF}; //25-31
+				bits = (bits | (masks[bits_to_take] << bit_index))
+				     & (((value & masks[bits_to_take]) << bit_index)
+				        | (masks[32] ^ (masks[bits_to_take] << bit_index)));
+		}
+		
+		uint32 read(uint32 bit_index, uint32 bits_to_take) const
+		{
+				uint32 masks[33] = {0, //0
+						1,3,7,15,31,63,127,255, //1-8
+						511,1023,2047,4095,8191,16383,32767,65535, //9-16
+						131071,262143,524287,1048575,2097151,4194303,8388607,16777215, //17-24
+						33554431,67108863,134217727,268435455,536870911,1073741823,2147483647,
+						0xFFFFFFFF}; //25-31
+				return (bits >> bit_index) & masks[bits_to_take];
+		}
+};
+
+/** Exposes the raw bits of a Note to seed a LegacyNote with. */
+class RawNote : public Note
+{
+public:
+		explicit RawNote(const Note& note) : Note(note) {}
+		uint32 bits() const            { return read(0, 32); }
+};
+
+template <class NoteType>
+static double timeAccessors(std::vector<NoteType>& notes, long& checksum)
+{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int repeat=0; repeat<numRepeats; repeat++)
+				for (int i=0; i<numNotes; i++)
+				{
+						NoteType& note = notes[i];
+						checksum += note.letter() + note.accidental() + note.octave() + note.voice();
+						note.octave(note.octave());
+						note.letter(note.letter());
+						note.accidental(note.accidental());
+						note.voice((repeat + i) % 4 + 1);
+				}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count() / ((double)numRepeats * numNotes);
+}
+
+int main()
+{
+		std::vector<Note> notes(numNotes);
+		std::vector<LegacyNote> legacyNotes(numNotes);
+		for (int i=0; i<numNotes; i++)
+		{
+				notes[i] = Note(i % 128);
+				legacyNotes[i] = LegacyNote(RawNote(notes[i]).bits());
+		}
+		
+		long layoutChecksum = 0, legacyChecksum = 0;
+		double legacyTime = timeAccessors(legacyNotes, legacyChecksum);
+		double layoutTime = timeAccessors(notes, layoutChecksum);
+		
+		printf("before: mask table read/write  %.2f ns/note  checksum %ld\n", legacyTime, legacyChecksum);
+		printf("after:  layout accessors       %.2f ns/note  checksum %ld\n", layoutTime, layoutChecksum);
+		return layoutChecksum == legacyChecksum ? 0 : 1;
+}
@@ -0,0 +1,537 @@
+//
+//  fmcalc.cpp
+//  FMCalculator
+//
+//  Command-line batch spectrum calculator.
+//
+//
+
+/*  fmcalc [options] [file]
+
+    Reads (carrier, C:M ratio, index) triples from file, or stdin when file is
+    missing or "-", and writes one spectrum record per triple to stdout:
+    the frequencies, the signed sideband amplitudes and the note names the
+    GUI shows under the spectrum.
+
+    Input is either CSV ("carrier,ratio,index" per line, blank lines and
+    lines starting with # ignored, an optional header line) or JSON lines
+    ({"carrier": 100, "ratio": 1.4, "index": 3} per line). The format is
+    guessed from the first record unless --from is given.
+
+    Input is read and computed in chunks of --chunk triples, so memory stays
+    bounded however long the input is. Each chunk is spread over a pool of
+    worker threads and written in input order, so the output does not depend
+    on the number of threads.
+
+    Options:
+        --from csv|json              input format
+        --to csv|json|binary         output format (default csv)
+        --chunk N                    triples per chunk (default 4096)
+        --threads N                  worker threads (default: one per CPU)
+        --table path                 use a BesselTable file for the coefficients
+
+    fmcalc --generate-table path [--max-index X] [--max-order N] [--accuracy E]
+
+    writes a BesselTable for --table (and for the app, which maps
+    FMCalculator/BesselTable.bin in the user's application data folder) and
+    exits. The defaults are the ones the app generates on first run: indices
+    0..30, orders 0..46 and an interpolation error below 1e-10, about 800 KB.
+    The file grows with max-index * (max-order + 2) / accuracy^(1/4).
+
+    CSV output has the header
+        line,carrier,ratio,index,partials,frequencies,amplitudes,notes
+    with frequencies and amplitudes as space separated lists and notes as
+    the quoted ",  " separated string.
+
+    Binary output starts with the 4 bytes "FMSB" and a uint32 version (1),
+    followed by one record per triple, all in host byte order:
+        uint64 line, double carrier, double ratio, double index,
+        uint32 partials, uint32 notes length,
+        double frequencies[partials], double amplitudes[partials],
+        char notes[notes length]            (not terminated)
+
+    Carriers must be positive and indices between 0 and 1000
+    (Bessel::maxIndex); every value must be a finite number. Malformed lines
+    and lines with values out of range are reported on stderr and skipped;
+    the exit status is then 1. Usage errors exit with 2.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include "BesselTable.h"
+#include "FMBatch.h"
+#include "NoteNames.h"
+
+enum InputFormat { InputUnknown, InputCSV, InputJSON };
+enum OutputFormat { OutputCSV, OutputJSON, OutputBinary };
+
+/** One chunk of input triples and the source line of each. */
+struct Chunk
+{
+		std::vector<uint64_t> lines;
+		std::vector<double> carriers;
+		std::vector<double> cmratios;
+		std::vector<double> indices;
+		std::vector<std::string> notes;
+		
+		size_t size() const { return lines.size(); }
+		
+		void clear()
+		{
+				lines.clear();
+				carriers.clear();
+				cmratios.clear();
+				indices.clear();
+		}
+};
+
+//==============================================================================
+static const char* skipSpace(const char* p)
+{
+		while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+				p++;
+		return p;
+}
+
+static bool readNumber(const char*& p, double& value)
+{
+		p = skipSpace(p);
+		char* end;
+		errno = 0;
+		value = strtod(p, &end);
+		if (end == p || errno == ERANGE || !std::isfinite(value))
+				return false;
+		p = skipSpace(end);
+		return true;
+}
+
+static bool parseCSV(const char* line, double values[3])
+{
+		const char* p = line;
+		for (int i=0; i<3; i++)
+		{
+				if (!readNumber(p, values[i]))
+						return false;
+				if (i < 2)
+				{
+						if (*p != ',')
+								return false;
+						p++;
+				}
+		}
+		return *p == 0;
+}
+
+/** Finds "key" at the top level of a flat JSON object and reads its number. */
+static bool readJSONField(const char* line, const char* key, double& value)
+{
+		size_t keyLength = strlen(key);
+		for (const char* p = strchr(line, '"'); p != nullptr; p = strchr(p + 1, '"'))
+		{
+				if (strncmp(p + 1, key, keyLength) != 0 || p[keyLength + 1] != '"')
+						continue;
+		
+				const char* q = skipSpace(p + keyLength + 2);
+				if (*q != ':')
+						continue;
+				q++;
+				return readNumber(q, value) && (*q == ',' || *q == '}');
+		}
+		return false;
+}
+
+static bool parseJSON(const char* line, double values[3])
+{
+		const char* p = skipSpace(line);
+		if (*p != '{')
+				return false;
+		return readJSONField(p, "carrier", values[0])
+		    && readJSONField(p, "ratio", values[1])
+		    && readJSONField(p, "index", values[2]);
+}
+
+/** Returns what is wrong with a parsed triple, or nullptr if it can be run. */
+static const char* checkValues(const double values[3])
+{
+		if (!(values[0] > 0))
+				return "carrier must be positive";
+		if (!(values[2] >= 0 && values[2] <= Bessel::maxIndex))
+				return "index out of range";
+		return nullptr;
+}
+
+//==============================================================================
+/** Reads lines from a FILE, growing the buffer for long lines. */
+class LineReader
+{
+public:
+		explicit LineReader(FILE* file)
+		: _file(file), _buffer(256), _lineNumber(0)
+		{
+		}
+		
+		/** Returns the next line without its line break, or nullptr at the end. */
+		const char* next()
+		{
+				size_t length = 0;
+				for (;;)
+				{
+						if (fgets(&_buffer[length], (int)(_buffer.size() - length), _file) == nullptr)
+						{
+								if (length == 0)
+										return nullptr;
+								break;
+						}
+						length += strlen(&_buffer[length]);
+						if (length > 0 && _buffer[length - 1] == '\n')
+								break;
+						if (length + 1 < _buffer.size())
+								continue;
+						_buffer.resize(_buffer.size() * 2);
+				}
+				_lineNumber++;
+				while (length > 0 && (_buffer[length - 1] == '\n' || _buffer[length - 1] == '\r'))
+						_buffer[--length] = 0;
+				return &_buffer[0];
+		}
+		
+		uint64_t getLineNumber() const { return _lineNumber; }
+
+private:
+		FILE* _file;
+		std::vector<char> _buffer;
+		uint64_t _lineNumber;
+};
+
+/** Fills chunk with up to capacity triples. Returns false once the input is
+    exhausted and nothing was read. */
+static bool readChunk(LineReader& reader, InputFormat& format, size_t capacity,
+                      Chunk& chunk, bool& hadErrors)
+{
+		chunk.clear();
+		while (chunk.size() < capacity)
+		{
+				const char* line = reader.next();
+				if (line == nullptr)
+						break;
+		
+				const char* p = skipSpace(line);
+				if (*p == 0 || *p == '#')
+						continue;
+		
+				if (format == InputUnknown)
+						format = (*p == '{') ? InputJSON : InputCSV;
+		
+				double values[3];
+				bool parsed = (format == InputJSON) ? parseJSON(p, values) : parseCSV(p, values);
+				if (!parsed)
+				{
+						// A CSV header naming the columns is allowed on the first line.
+						if (format == InputCSV && reader.getLineNumber() == 1 && isalpha((unsigned char)*p))
+								continue;
+		
+						fprintf(stderr, "fmcalc: line %llu: expected %s, skipped\n",
+						        (unsigned long long)reader.getLineNumber(),
+						        format == InputJSON ? "{\"carrier\": c, \"ratio\": r, \"index\": i}"
+						                            : "carrier,ratio,index");
+						hadErrors = true;
+						continue;
+				}
+		
+				if (const char* problem = checkValues(values))
+				{
+						fprintf(stderr, "fmcalc: line %llu: %s, skipped\n",
+						        (unsigned long long)reader.getLineNumber(), problem);
+						hadErrors = true;
+						continue;
+				}
+		
+				chunk.lines.push_back(reader.getLineNumber());
+				chunk.carriers.push_back(values[0]);
+				chunk.cmratios.push_back(values[1]);
+				chunk.indices.push_back(values[2]);
+		}
+		return chunk.size() > 0;
+}
+
+//==============================================================================
+struct NamingRange
+{
+		const FMBatch* batch;
+		Chunk* chunk;
+		size_t start, end;
+};
+
+static void nameRange(NamingRange range)
+{
+		// Written into a buffer and assigned, so the strings of a reused
+		// chunk keep their storage.
+		char buffer[NoteNames::maxTextLength + 1];
+		for (size_t i = range.start; i < range.end; i++)
+		{
+				size_t length = NoteNames::write(range.batch->getSpectrum(i), range.batch->getSpectrumSize(i),
+				                                 buffer, sizeof(buffer));
+				range.chunk->notes[i].assign(buffer, length);
+		}
+}
+
+/** Converts every spectrum of the chunk to its note names on numThreads threads. */
+static void nameChunk(const FMBatch& batch, Chunk& chunk, int numThreads)
+{
+		chunk.notes.resize(chunk.size());
+		
+		size_t count = chunk.size();
+		size_t perThread = (count + numThreads - 1) / numThreads;
+		std::vector<std::thread> workers;
+		for (size_t start = perThread; start < count; start += perThread)
+		{
+				NamingRange range = { &batch, &chunk, start, std::min(count, start + perThread) };
+				workers.push_back(std::thread(nameRange, range));
+		}
+		
+		NamingRange first = { &batch, &chunk, 0, std::min(count, perThread) };
+		nameRange(first);
+		
+		for (size_t i=0; i<workers.size(); i++)
+				workers[i].join();
+}
+
+//==============================================================================
+static void writeList(FILE* out, const double* values, size_t count, char separator)
+{
+		for (size_t k=0; k<count; k++)
+		{
+				if (k > 0)
+						fputc(separator, out);
+				fprintf(out, "%.17g", values[k]);
+		}
+}
+
+static void writeCSV(FILE* out, const FMBatch& batch, const Chunk& chunk)
+{
+		for (size_t i=0; i<chunk.size(); i++)
+		{
+				size_t size = batch.getSpectrumSize(i);
+				fprintf(out, "%llu,%.17g,%.17g,%.17g,%u,", (unsigned long long)chunk.lines[i],
+				        chunk.carriers[i], chunk.cmratios[i], chunk.indices[i], (unsigned)size);
+				writeList(out, batch.getSpectrum(i), size, ' ');
+				fputc(',', out);
+				writeList(out, batch.getAmplitudes(i), size, ' ');
+				fprintf(out, ",\"%s\"\n", chunk.notes[i].c_str());
+		}
+}
+
+static void writeJSON(FILE* out, const FMBatch& batch, const Chunk& chunk)
+{
+		for (size_t i=0; i<chunk.size(); i++)
+		{
+				size_t size = batch.getSpectrumSize(i);
+				fprintf(out, "{\"line\": %llu, \"carrier\": %.17g, \"ratio\": %.17g, \"index\": %.17g, \"frequencies\": [",
+				        (unsigned long long)chunk.lines[i], chunk.carriers[i], chunk.cmratios[i], chunk.indices[i]);
+				writeList(out, batch.getSpectrum(i), size, ',');
+				fputs("], \"amplitudes\": [", out);
+				writeList(out, batch.getAmplitudes(i), size, ',');
+				fprintf(out, "], \"notes\": \"%s\"}\n", chunk.notes[i].c_str());
+		}
+}
+
+static void writeBinaryHeader(FILE* out)
+{
+		uint32_t version = 1;
+		fwrite("FMSB", 1, 4, out);
+		fwrite(&version, sizeof(version), 1, out);
+}
+
+static void writeBinary(FILE* out, const FMBatch& batch, const Chunk& chunk)
+{
+		for (size_t i=0; i<chunk.size(); i++)
+		{
+				uint64_t line = chunk.lines[i];
+				double parameters[3] = { chunk.carriers[i], chunk.cmratios[i], chunk.indices[i] };
+				uint32_t counts[2] = { (uint32_t)batch.getSpectrumSize(i), (uint32_t)chunk.notes[i].size() };
+		
+				fwrite(&line, sizeof(line), 1, out);
+				fwrite(parameters, sizeof(double), 3, out);
+				fwrite(counts, sizeof(uint32_t), 2, out);
+				fwrite(batch.getSpectrum(i), sizeof(double), counts[0], out);
+				fwrite(batch.getAmplitudes(i), sizeof(double), counts[0], out);
+				fwrite(chunk.notes[i].data(), 1, counts[1], out);
+		}
+}
+
+//==============================================================================
+static int usage()
+{
+		fprintf(stderr,
+		        "usage: fmcalc [--from csv|json] [--to csv|json|binary] [--chunk N]\n"
+		        "              [--threads N] [--table path] [file]\n"
+		        "       fmcalc --generate-table path [--max-index X] [--max-order N]\n"
+		        "              [--accuracy E]\n");
+		return 2;
+}
+
+static bool readCount(const char* text, long& value)
+{
+		char* end;
+		value = strtol(text, &end, 10);
+		return end != text && *end == 0 && value > 0;
+}
+
+static bool readPositive(const char* text, double& value)
+{
+		char* end;
+		value = strtod(text, &end);
+		return end != text && *end == 0 && std::isfinite(value) && value > 0;
+}
+
+static int generateTable(const char* path, double maxIndex, long maxOrder, double accuracy)
+{
+		if (!BesselTable::generate(path, maxIndex, (int)maxOrder, accuracy))
+		{
+				fprintf(stderr, "fmcalc: cannot write %s: %s\n", path, strerror(errno));
+				return 1;
+		}
+		return 0;
+}
+
+int main(int argc, char* argv[])
+{
+		InputFormat inputFormat = InputUnknown;
+		OutputFormat outputFormat = OutputCSV;
+		long chunkSize = 4096;
+		long numThreads = 0;
+		const char* tablePath = nullptr;
+		const char* inputPath = nullptr;
+		const char* generatePath = nullptr;
+		double maxIndex = BesselTable::defaultMaxIndex;
+		long maxOrder = BesselTable::defaultMaxOrder;
+		double accuracy = BesselTable::defaultAccuracy;
+		
+		for (int i=1; i<argc; i++)
+		{
+				std::string arg = argv[i];
+				bool hasValue = i + 1 < argc;
+		
+				if (arg == "--from" && hasValue)
+				{
+						std::string value = argv[++i];
+						if (value == "csv")       inputFormat = InputCSV;
+						else if (value == "json") inputFormat = InputJSON;
+						else                      return usage();
+				}
+				else if (arg == "--to" && hasValue)
+				{
+						std::string value = argv[++i];
+						if (value == "csv")         outputFormat = OutputCSV;
+						else if (value == "json")   outputFormat = OutputJSON;
+						else if (value == "binary") outputFormat = OutputBinary;
+						else                        return usage();
+				}
+				else if (arg == "--chunk" && hasValue)
+				{
+						if (!readCount(argv[++i], chunkSize))
+								return usage();
+				}
+				else if (arg == "--threads" && hasValue)
+				{
+						if (!readCount(argv[++i], numThreads))
+								return usage();
+				}
+				else if (arg == "--table" && hasValue)
+						tablePath = argv[++i];
+				else if (arg == "--generate-table" && hasValue)
+						generatePath = argv[++i];
+				else if (arg == "--max-index" && hasValue)
+				{
+						if (!readPositive(argv[++i], maxIndex) || maxIndex > Bessel::maxIndex)
+								return usage();
+				}
+				else if (arg == "--max-order" && hasValue)
+				{
+						if (!readCount(argv[++i], maxOrder) || maxOrder > Bessel::orderLimit(Bessel::maxIndex))
+								return usage();
+				}
+				else if (arg == "--accuracy" && hasValue)
+				{
+						if (!readPositive(argv[++i], accuracy))
+								return usage();
+				}
+				else if ((arg == "-" || arg[0] != '-') && inputPath == nullptr)
+						inputPath = argv[i];
+				else
+						return usage();
+		}
+		
+		if (generatePath != nullptr)
+				return generateTable(generatePath, maxIndex, maxOrder, accuracy);
+		
+		if (numThreads == 0)
+				numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+		
+		FILE* in = stdin;
+		if (inputPath != nullptr && strcmp(inputPath, "-") != 0)
+		{
+				in = fopen(inputPath, "r");
+				if (in == nullptr)
+				{
+						fprintf(stderr, "fmcalc: cannot open %s: %s\n", inputPath, strerror(errno));
+						return 2;
+				}
+		}
+		
+		std::unique_ptr<BesselTable> table;
+		if (tablePath != nullptr)
+		{
+				table.reset(new BesselTable(tablePath));
+				if (!table->isValid())
+				{
+						fprintf(stderr, "fmcalc: %s is not a Bessel table\n", tablePath);
+						if (in != stdin)
+								fclose(in);
+						return 2;
+				}
+		}
+		
+		FILE* out = stdout;
+		if (outputFormat == OutputBinary)
+				writeBinaryHeader(out);
+		else if (outputFormat == OutputCSV)
+				fputs("line,carrier,ratio,index,partials,frequencies,amplitudes,notes\n", out);
+		
+		LineReader reader(in);
+		Chunk chunk;
+		FMBatch batch;
+		bool hadErrors = false;
+		
+		while (readChunk(reader, inputFormat, (size_t)chunkSize, chunk, hadErrors))
+		{
+				batch.run(chunk.carriers.data(), chunk.cmratios.data(), chunk.indices.data(),
+				          chunk.size(), (int)numThreads, table.get());
+				nameChunk(batch, chunk, (int)numThreads);
+		
+				switch (outputFormat)
+				{
+						case OutputCSV:    writeCSV(out, batch, chunk); break;
+						case OutputJSON:   writeJSON(out, batch, chunk); break;
+						case OutputBinary: writeBinary(out, batch, chunk); break;
+				}
+		}
+		
+		bool failed = ferror(in) != 0 || fflush(out) != 0 || ferror(out) != 0;
+		if (failed)
+				fprintf(stderr, "fmcalc: %s\n", strerror(errno));
+		
+		if (in != stdin)
+				fclose(in);
+		
+		return (failed || hadErrors) ? 1 : 0;
+}
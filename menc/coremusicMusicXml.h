@@ -28,6 +28,7 @@ namespace menc
 
     Score* parseSATB()
     {
+      ScopedAllocationSite site("MusicXmlDocument::parseSATB");
       xercesc::DOMElement* rootnode=getDocumentElement();
       menc::Array<xercesc::DOMElement*> partnodes;
       menc::Array<menc::String> partnames;
@@ -174,6 +175,7 @@ namespace menc
 
     bool parsePart(xercesc::DOMElement* part, Array<ScoreData*>& scoredata)
     {
+      ScopedAllocationSite site("MusicXmlDocument::parsePart");
       XMLCh Xattributes [32];
       XMLCh Xsound [32];
       XMLCh Xtempo [32];
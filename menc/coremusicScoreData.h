@@ -27,6 +27,22 @@ namespace menc
     
     virtual ~ScoreData() {};
 
+    /** Score data is allocated from the current MemoryResource, so that
+        loading a score can be tracked or given an arena. **/
+
+    static void* operator new(size_t bytes)
+    {
+      void* data = MemoryResource::allocateFromCurrent(bytes);
+      if (!data)
+        throw std::bad_alloc();
+      return data;
+    }
+
+    static void operator delete(void* data)
+    {
+      MemoryResource::deallocateToOwner(data);
+    }
+
     /** Impelemeted by subclasses to return a string reprentation of
         their data. **/
 
@@ -15,6 +15,7 @@
 #include "mencInstruments.h"
 #include "mencBitfields.h"
 #include "mencChords.h"
+#include "mencSetClasses.h"
 #include "mencLetters.h"
 #include "mencMarks.h"
 #include "mencOctaves.h"
@@ -31,4 +32,5 @@
 #include "mencIntervals.h"
 #include "mencClefs.h"
 #include "mencKeys.h"
+#include "mencMemory.h"
 #include "mencArray.h"
@@ -8,23 +8,65 @@
 #ifndef menc_Array_h
 #define menc_Array_h
 
-//For placement new, memset, and memcpy.
+//For placement new, size_t and memset.
 #include <new>
+#include <cstddef>
 #include <string>
+#include <cstring>
+#include "mencMemory.h"
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  #define MENC_ARRAY_MOVE_SEMANTICS 1
+#endif
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1700)
+  #define MENC_ARRAY_THREADS 1
+  #include <algorithm>
+  #include <thread>
+  #include <vector>
+#endif
 
 namespace menc
 {
+  /**The default allocator of Array's heap storage, which takes it from the
+  current MemoryResource of the thread (see mencMemory.h). An allocator is
+  a class with static allocate and deallocate methods, so it adds nothing
+  to the size of the array; pass another as Array's third template argument
+  to take the storage from somewhere else.*/
+  class ArrayAllocator
+  {
+  public:
+    static void* allocate(size_t Bytes)
+    {
+      return MemoryResource::allocateFromCurrent(Bytes);
+    }
+
+    static void deallocate(void* Data, size_t Bytes)
+    {
+      (void)Bytes;
+      MemoryResource::deallocateToOwner(Data);
+    }
+  };
+
   /**A smart array with exponential (base-two) element creation. Since
   reallocations only occur at the base-two increments (1 unit, 2 units,
   4 units, 8 units, etc.) very little time is spent overall doing memory
-  copies.*/
-  template <class T>
+  copies.
+  
+  Up to InlineCapacity elements are stored inside the array itself, so the
+  short arrays of marks, beams, slurs and chord members never touch the
+  heap; by default small elements get four inline slots and larger ones
+  none. Elements are relocated by move (or copy) construction, never by
+  copying their bytes, so any copyable type can be stored. Storage grows
+  to the next power of two and is only given back once the array has
+  shrunk to a quarter of it, so sizes going up and down across a power of
+  two do not reallocate every time.*/
+  template <class T, int InlineCapacity = (sizeof(T) <= 16 ? 4 : 0),
+    class Allocator = ArrayAllocator>
   class Array
   {
-    /**A wrapper for clearing and copying memory via templated methods. You should
-    only use these methods on plain-old data objects, that is, objects not
-    containing members with their own special constructors or containing virtual
-    methods (and thus a vtable which would be wiped out).*/
+    /**A wrapper for clearing memory via templated methods and constructing
+    elements in place.*/
     class Memory
     {
       ///Private wrapper for memset. Use Clear instead since it is strongly typed.
@@ -35,61 +77,88 @@ namespace menc
           memset(Destination, ValueToSet, BytesToSet);
       }
 
-      ///Private wrapper for memcpy. Use Copy instead since it is strongly typed.
-      static void MemCopy(void* Destination, void* Source,
-        int BytesToCopy)
-      {
-        if(Destination != 0 && Source != 0 && BytesToCopy > 0)
-          memcpy(Destination, Source, BytesToCopy);
-      }
-
     public:
     
-      ///Clears an object with a particular byte-value.
+      ///Clears an array of consecutive objects with a particular byte-value.
       template <class Type>
-      static void Clear(Type& Object, unsigned char Value = 0)
+      static void Clear(Type* Object, int Items, unsigned char Value = 0)
       {
-        MemSet((void*)&Object, Value, sizeof(Type));
+        MemSet((void*)Object, Value, sizeof(Type) * Items);
       }
 
-      ///Clears an array of consecutive objects with a particular byte-value.
+      /**Calls a placement new on an object. A placement new is used to call an
+      object's constructor in the case that the memory for the object has already
+      been allocated.*/
       template <class Type>
-      static void Clear(Type* Object, int Items, unsigned char Value = 0)
+      static Type* PlacementNew(Type* Object)
       {
-        MemSet((void*)Object, Value, sizeof(Type) * Items);
+        return new (Object) Type;
       }
 
-      ///Copies an object's data to another object.
+      ///Constructs a copy of Source in the memory of Object.
       template <class Type>
-      static void Copy(Type& Destination, const Type& Source)
+      static Type* PlacementCopy(Type* Object, const Type& Source)
       {
-        MemCopy((void*)&Destination, (void*)&Source, sizeof(Type));
+        return new (Object) Type(Source);
       }
 
-      ///Copies an array of consecutive objects to another array.
+#if MENC_ARRAY_MOVE_SEMANTICS
+      ///Returns Object as an rvalue so that it may be moved from.
+      template <class Type>
+      static Type&& Movable(Type& Object)
+      {
+        return static_cast<Type&&>(Object);
+      }
+#else
+      ///Returns Object unchanged; without rvalue references it is copied.
       template <class Type>
-      static void Copy(Type* Destination, const Type* Source, int Items)
+      static Type& Movable(Type& Object)
       {
-        MemCopy((void*)Destination, (void*)Source, sizeof(Type) * Items);
+        return Object;
       }
+#endif
 
-      /**Calls a placement new on an object. A placement new is used to call an
-      object's constructor in the case that the memory for the object has already
-      been allocated.*/
+      /**Moves Items objects into uninitialized memory at Destination and
+      destroys the originals.*/
       template <class Type>
-      static Type* PlacementNew(Type* Object)
+      static void Relocate(Type* Destination, Type* Source, int Items)
       {
-        return new (Object) Type;
+        for(int i = 0; i < Items; i++)
+        {
+          new (&Destination[i]) Type(Movable(Source[i]));
+          Source[i].~Type();
+        }
       }
     };
     
     //------------//
     //Data Members//
     //------------//
-    void* Data;
+    T* Data;
     
     int LogicalSize;
 
+    int PhysicalSize;
+
+    //Inline element storage, aligned for the element types menc stores.
+    union InlineStorage
+    {
+      unsigned char Bytes[InlineCapacity > 0 ? sizeof(T) * InlineCapacity : 1];
+      double AlignDouble;
+      int64 AlignInt64;
+      void* AlignPointer;
+    } Inline;
+
+    inline T* inlineData(void)
+    {
+      return (T*)Inline.Bytes;
+    }
+
+    inline bool isInline(void) const
+    {
+      return (const void*)Data == (const void*)Inline.Bytes;
+    }
+
     static int calculatePhysicalSizeFromLogical(int Logical)
     {
       //Return 0 if bad argument.
@@ -116,6 +185,61 @@ namespace menc
       return 0;
     }
 
+    /**Moves the elements into storage for NewPhysicalSize elements, the
+    inline storage if they fit. Returns false if memory could not be
+    allocated.*/
+    bool reallocate(int NewPhysicalSize)
+    {
+      T* NewData;
+      if(NewPhysicalSize <= InlineCapacity)
+      {
+        if(isInline())
+          return true;
+        NewData = inlineData();
+        NewPhysicalSize = InlineCapacity;
+      }
+      else
+      {
+        NewData = (T*)Allocator::allocate(sizeof(T) * NewPhysicalSize);
+        if(!NewData)
+          return false;
+      }
+
+      Memory::Relocate(NewData, Data, LogicalSize);
+      releaseHeap();
+      Data = NewData;
+      PhysicalSize = NewPhysicalSize;
+      return true;
+    }
+
+    ///Frees the heap storage, if any, without touching the elements.
+    void releaseHeap(void)
+    {
+      if(!isInline())
+        Allocator::deallocate(Data, sizeof(T) * PhysicalSize);
+      Data = inlineData();
+      PhysicalSize = InlineCapacity;
+    }
+
+    ///Takes the elements of another array, leaving it empty.
+    void takeFrom(Array& Other)
+    {
+      if(Other.isInline())
+      {
+        Memory::Relocate(Data, Other.Data, Other.LogicalSize);
+        LogicalSize = Other.LogicalSize;
+      }
+      else
+      {
+        Data = Other.Data;
+        LogicalSize = Other.LogicalSize;
+        PhysicalSize = Other.PhysicalSize;
+        Other.Data = Other.inlineData();
+        Other.PhysicalSize = InlineCapacity;
+      }
+      Other.LogicalSize = 0;
+    }
+
   public:
     ///Returns the size of the array.
     inline int n(void) const
@@ -129,111 +253,91 @@ namespace menc
       return LogicalSize;
     }
 
+    ///Returns how many elements the array can hold without reallocating.
+    inline int capacity(void) const
+    {
+      return PhysicalSize;
+    }
+
     ///Sets the size of the array.
     T* n(int NewLogicalSize)
     {
       //In case the new requested size is the same, quickly return.
       if(NewLogicalSize == LogicalSize)
-        return (T*)Data;
+        return LogicalSize ? Data : 0;
       
-      //In the case of a no size array, just delete all the data.
-      if(NewLogicalSize <= 0)
-      {
-        //Call all the destructors.
-        for(int i = 0; i < LogicalSize; i++)
-          ((T*)Data)[i].~T();
-        delete [] (unsigned char*)Data;
-        Data = 0;
-        LogicalSize = 0;
-        return 0;
-      }
+      if(NewLogicalSize < 0)
+        NewLogicalSize = 0;
 
-      /*Since this class uses an exponential expansion model, the size will only
-      increase at powers of two. This means in exchange for using up a little
-      more memory, there are much fewer actual allocations.*/
-      int OldPhysicalSize = calculatePhysicalSizeFromLogical(LogicalSize);
-      int NewPhysicalSize = calculatePhysicalSizeFromLogical(NewLogicalSize);
-
-      /*If no extra data needs to be allocated, then just change the size of the
-      array.*/
-      if(OldPhysicalSize == NewPhysicalSize)
+      if(NewLogicalSize > PhysicalSize)
       {
-        //Zero out any previously uninitialized elements.
-        if(NewLogicalSize > LogicalSize)
-        {
-          Memory::Clear(&((T*)Data)[LogicalSize], NewLogicalSize - LogicalSize);
-
-          //Call the constructors of the new objects.
-          for(int i = LogicalSize; i < NewLogicalSize; i++)
-            Memory::PlacementNew(&((T*)Data)[i]);
-        }
-        else //Assume that NewLogicalSize is less than LogicalSize.
-        {
-          //Call the destructors for the objects that are being removed.
-          for(int i = NewLogicalSize; i < LogicalSize; i++)
-            ((T*)Data)[i].~T();
-        }
-        
-        //Set the new size of the array.
-        LogicalSize = NewLogicalSize;
-        return (T*)Data;
+        /*Since this class uses an exponential expansion model, the size will
+        only increase at powers of two. This means in exchange for using up a
+        little more memory, there are much fewer actual allocations.*/
+        int NewPhysicalSize = calculatePhysicalSizeFromLogical(NewLogicalSize);
+        if(NewPhysicalSize == 0 || !reallocate(NewPhysicalSize))
+          return 0;
       }
 
-      //Allocate a new contiguous block of memory.
-      void* NewData = (void*)new unsigned char[sizeof(T) * NewPhysicalSize];
-
-      //If memory could not be allocated, return zero.
-      if(!NewData)
-        return 0;
-
-      //Test to see if the array is getting bigger or smaller.
       if(NewLogicalSize > LogicalSize)
       {
-        //Copy original data and zero out the new portion.
-        Memory::Copy((T*)NewData, (T*)Data, LogicalSize);
-        Memory::Clear(&((T*)NewData)[LogicalSize], 0,
-          NewLogicalSize - LogicalSize);
+        //Zero out and construct the new elements.
+        Memory::Clear(&Data[LogicalSize], NewLogicalSize - LogicalSize);
         for(int i = LogicalSize; i < NewLogicalSize; i++)
-          Memory::PlacementNew(&((T*)NewData)[i]);
+          Memory::PlacementNew(&Data[i]);
       }
-      else //Assume that NewLogicalSize is less than LogicalSize.
+      else
       {
-        //Call the destructors of the objects being removed.
+        //Call the destructors for the objects that are being removed.
         for(int i = NewLogicalSize; i < LogicalSize; i++)
-          ((T*)Data)[i].~T();
-
-        //Copy data into a smaller array.
-        Memory::Copy((T*)NewData, (T*)Data, NewLogicalSize);
+          Data[i].~T();
       }
+      int OldLogicalSize = LogicalSize;
+      LogicalSize = NewLogicalSize;
 
-      //Delete old array.
-      delete [] (unsigned char*)Data;
+      /*Only give memory back once the array has shrunk to a quarter of it,
+      and keep twice what is left, so that an array whose size goes back and
+      forth across a power of two does not reallocate every time.*/
+      if(NewLogicalSize < OldLogicalSize && !isInline() &&
+        NewLogicalSize <= PhysicalSize / 4)
+          reallocate(calculatePhysicalSizeFromLogical(NewLogicalSize * 2));
 
-      //Set the new size of the array.
-      LogicalSize = NewLogicalSize;
+      return LogicalSize ? Data : 0;
+    }
 
-      //Return pointer to the new data array.
-      return (T*)(Data = NewData);
+    /**Makes room for at least Size elements without changing the size of
+    the array, so that adding up to that many does not reallocate.*/
+    void reserve(int Size)
+    {
+      if(Size > PhysicalSize)
+      {
+        int NewPhysicalSize = calculatePhysicalSizeFromLogical(Size);
+        if(NewPhysicalSize != 0)
+          reallocate(NewPhysicalSize);
+      }
     }
 
-    ///Clears the array.
+    ///Clears the array and frees its memory.
     inline void clear(void)
     {
-      n(0);
+      for(int i = 0; i < LogicalSize; i++)
+        Data[i].~T();
+      LogicalSize = 0;
+      releaseHeap();
     }
     
     /**Returns the first element of the array. Note that 'first' is lowercase
     since it is treated as a mathematical variable.*/
     inline T& first(void)
     {
-      return *((T*)Data);
+      return *Data;
     }
     
     /**Returns the last element of the array. Note that 'last' is lowercase
     since it is treated as a mathematical variable.*/
     inline T& last(void)
     {
-      return ((T*)Data)[LogicalSize - 1];
+      return Data[LogicalSize - 1];
     }
 
     /** Returns the first element in the array or 0 if the array is empty. **/
@@ -242,7 +346,7 @@ namespace menc
     {
       if (!size())
         return T();
-      return *((T*)Data);
+      return *Data;
     }
     
     /** Returns the last element in the array or 0 if array is empty. **/
@@ -251,7 +355,7 @@ namespace menc
     {
       if (!size())
         return T();
-      return ((T*)Data)[LogicalSize - 1];
+      return Data[LogicalSize - 1];
     }
 
     /** Returns true if the array contains element otherwise false. **/
@@ -259,7 +363,7 @@ namespace menc
     bool contains(const T& element)
     {
       for (int i=0; i<size(); i++)
-        if (((T*)Data)[i] == element)
+        if (Data[i] == element)
         return true;
       return false;
     }
@@ -269,7 +373,7 @@ namespace menc
     int indexOf(const T& element)
     {
       for (int i=0; i<size(); i++)
-        if (((T*)Data)[i] == element)
+        if (Data[i] == element)
         return i;
       return -1;
     }
@@ -277,9 +381,35 @@ namespace menc
     ///Adds an element to the end of the array using a copy constructor.
     void add(const T& NewElement)
     {
-      n(LogicalSize + 1);
-      ((T*)Data)[LogicalSize - 1] = NewElement;
+      if(LogicalSize < PhysicalSize)
+        Memory::PlacementCopy(&Data[LogicalSize], NewElement);
+      else
+      {
+        //The element may be in this array, so copy it before growing.
+        T Copy(NewElement);
+        if(!reallocate(calculatePhysicalSizeFromLogical(LogicalSize + 1)))
+          return;
+        new (&Data[LogicalSize]) T(Memory::Movable(Copy));
+      }
+      LogicalSize++;
+    }
+
+#if MENC_ARRAY_MOVE_SEMANTICS
+    ///Adds an element to the end of the array by moving it in.
+    void add(T&& NewElement)
+    {
+      if(LogicalSize < PhysicalSize)
+        new (&Data[LogicalSize]) T(Memory::Movable(NewElement));
+      else
+      {
+        T Moved(Memory::Movable(NewElement));
+        if(!reallocate(calculatePhysicalSizeFromLogical(LogicalSize + 1)))
+          return;
+        new (&Data[LogicalSize]) T(Memory::Movable(Moved));
+      }
+      LogicalSize++;
     }
+#endif
 
     /** Replaces an element with a new value. If the index is less
         than zero, this method does nothing. If the index is beyond
@@ -292,7 +422,7 @@ namespace menc
       if (index >= 0)
         {
           if (index < size())
-            ((T*)Data)[index] = element;
+            Data[index] = element;
           else
             add(element);
         }
@@ -317,10 +447,11 @@ namespace menc
         add(newElement);
       else
         {
+          T Copy(newElement);
           n(LogicalSize + 1);
           for (int i= size()-2; i >= indexToInsertAt; i--)
-            ((T*)Data)[i+1] = ((T*)Data)[i];
-          ((T*)Data)[indexToInsertAt] = newElement;
+            Data[i+1] = Memory::Movable(Data[i]);
+          Data[indexToInsertAt] = Memory::Movable(Copy);
         }
     }
     /** Appends a new element to the end of the array if the array
@@ -342,7 +473,7 @@ namespace menc
       if (index >= 0 && index < size())
         {
           for (int i= index+1; i < size(); i++)
-            ((T*)Data)[i-1] = ((T*)Data)[i];
+            Data[i-1] = Memory::Movable(Data[i]);
           n(LogicalSize - 1);
         }
     }
@@ -363,14 +494,14 @@ namespace menc
 
     inline T& operator[] (int Index) const
     {
-      return ((T*)Data)[Index];
+      return Data[Index];
     }
 
     /**Returns an element by index. The method does not check bounds before
     attempting to access the data. */
     inline T& getUnchecked(int Index) const
     {
-      return ((T*)Data)[Index];
+      return Data[Index];
     }
 
 
@@ -378,21 +509,21 @@ namespace menc
     attempting to access the data. The element itself has read-write access.*/
     inline T& getItem(int Index) const
     {
-      return ((T*)Data)[Index];
+      return Data[Index];
     }
 
     /**Returns an element read-only by index. The method does not check bounds
     before attempting to access the data.*/
     inline const T& getConstItem(int Index) const
     {
-      return (const T&)(((T*)Data)[Index]);
+      return Data[Index];
     }
     
     /**Returns the value of an element given its index. Changing the value does
     not change the array since the value returned is a copy.*/
     inline T getItemValue(int Index) const
     {
-      return ((T*)Data)[Index];
+      return Data[Index];
     }
 
     /** Reverses the order of the elements in the array. **/
@@ -402,25 +533,25 @@ namespace menc
      for (int i = 0; i < size() / 2; i++)
       {
         int j = (size() - 1 ) - i;
-        T x=getItem(i);
-        getItem(i)=getItem(j);
-        getItem(j)=x;
+        T x=Memory::Movable(getItem(i));
+        getItem(i)=Memory::Movable(getItem(j));
+        getItem(j)=Memory::Movable(x);
       }
     }
 
 
     ///Creates an array with no elements.
-    Array() : Data(0), LogicalSize(0) {}
+    Array() : Data(inlineData()), LogicalSize(0), PhysicalSize(InlineCapacity) {}
 
     ///Constructs the array with the given number of elements.
-    Array(int Size) : Data(0), LogicalSize(0) {n(Size);}
+    Array(int Size) : Data(inlineData()), LogicalSize(0),
+      PhysicalSize(InlineCapacity) {n(Size);}
 
     /**Copys another array into this one. First the array is resized to have the
     same number of elements as the other. Then each element from the other is
     copied by assignment. Note that the resizing step will cause constructors
-    to be called, which may be inefficient. If your array contains plain-old
-    data then you are better off using the CopyMemoryFrom() method.*/
-    void copyFrom(const Array<T>& Other)
+    to be called, which may be inefficient.*/
+    void copyFrom(const Array& Other)
     {
       //If the source and destination are the same, no copying is necessary.
       if(&Other == this)
@@ -431,119 +562,340 @@ namespace menc
       
       //Copy each element by assignment.
       for(int i = 0; i < LogicalSize; i++)
-        ((T*)Data)[i] = ((T*)Other.Data)[i];
+        Data[i] = Other.Data[i];
     }
     
     /** Adds elements from an array to the end of this array. **/
-    void addArray(const Array<T>& other)
+    void addArray(const Array& other)
     {
-      int pos=size();
-      n(LogicalSize+other.size());
-      for (int i = 0; i < other.size(); i++)
-        ((T*)Data)[pos+i] = ((T*)other.Data)[i];
+      int pos=size(), count=other.size();
+      n(LogicalSize+count);
+      for (int i = 0; i < count; i++)
+        Data[pos+i] = other.Data[i];
     }
 
-    /**Copies the memory of another array into this one. First the array is
-    resized to have the same number of elements. Then a memory copy operation is
-    done on the array to copy the contents of the other array byte-for-byte into
-    this one. Note well, in order for this to be valid, the elements must be
-    plain-old data, i.e., they must not contain members with special
-    constructors and must not contain virtual methods. Use the CopyFrom() method
-    for complex objects so that they will be properly copied using the
-    assignment operator.*/
-    void copyMemoryFrom(const Array<T>& Other)
+    /**Copies another array into this one. This used to copy the elements
+    byte-for-byte, which is only valid for plain-old data; it now copies
+    them by assignment like copyFrom(), which compiles to the same memory
+    copy for plain-old data.*/
+    void copyMemoryFrom(const Array& Other)
     {
-      //If the source and destination are the same, no copying is necessary.
-      if(&Other == this)
-        return;
-      
-      //Resize the array to be the size of the other.
-      n(Other.LogicalSize);
-      
-      //Copy the entire array as plain-old data.
-      Memory::Copy(first(), Other.first(), n()); 
+      copyFrom(Other);
     }
 
-    /**Safe copy constructor. Internally calls the CopyFrom() method. Normally
-    you would want to use references to the Array (when possible) so that its
-    contents are not needlessly copied. You could also use CopyMemoryFrom() if
-    your element is plain-old data.*/
-    Array(const Array<T> &Other) : Data(0), LogicalSize(0) {CopyFrom(Other);}
+    /**Safe copy constructor. Each element is copy constructed from the
+    other's. Normally you would want to use references to the Array (when
+    possible) so that its contents are not needlessly copied.*/
+    Array(const Array& Other) : Data(inlineData()), LogicalSize(0),
+      PhysicalSize(InlineCapacity)
+    {
+      reserve(Other.LogicalSize);
+      for(int i = 0; i < Other.LogicalSize; i++)
+        Memory::PlacementCopy(&Data[i], Other.Data[i]);
+      LogicalSize = Other.LogicalSize;
+    }
     
-    /**Memory-based copy constructor from array data. This method will only
-    call the constructors of the newly created elements. Then it performs a
-    memory copy from the source array. If your source is already an Array, then
-    you would normally pass in the Array object so that the assignment operators
-    will be used. You should only use this copy constructor if your elements are
-    plain-old data.*/
-    Array(const T* OtherData, int Length) : Data(0), LogicalSize(0)
-    {
-      //Resize the array.
-      n(Length);
-      
-      //If the source and destination are the same, no copying is necessary.
-      if((T*)Data == OtherData)
+    /**Copy constructor from array data. Each element is copy constructed
+    from the corresponding element of the source.*/
+    Array(const T* OtherData, int Length) : Data(inlineData()), LogicalSize(0),
+      PhysicalSize(InlineCapacity)
+    {
+      if(Length <= 0)
         return;
-      
-      //Copy the entire array as plain-old data.
-      Memory::Copy((T*)Data, OtherData, Length);
+      reserve(Length);
+      for(int i = 0; i < Length; i++)
+        Memory::PlacementCopy(&Data[i], OtherData[i]);
+      LogicalSize = Length;
     }
 
     ///Assignment operator to safely copy another array to this one.
-    Array<T>& operator = (const Array<T>& Other)
+    Array& operator = (const Array& Other)
     {
       copyFrom(Other);
       return *this;
     }
 
+#if MENC_ARRAY_MOVE_SEMANTICS
+    /**Move constructor. A heap array is taken over without touching its
+    elements; inline elements are moved one by one. The other array is left
+    empty.*/
+    Array(Array&& Other) : Data(inlineData()), LogicalSize(0),
+      PhysicalSize(InlineCapacity)
+    {
+      takeFrom(Other);
+    }
+
+    ///Move assignment. The other array is left empty.
+    Array& operator = (Array&& Other)
+    {
+      if(&Other != this)
+      {
+        clear();
+        takeFrom(Other);
+      }
+      return *this;
+    }
+#endif
+
     ///Destroys the array, calling each of the items' destructors.
-    virtual ~Array() {n(0);}
+    virtual ~Array() {clear();}
     
     private:
     
-    ///Private helper that implements Quicksort recursion.
-    static void quicksortRecursive(T* ArrayData, int Left, int Right)
+    //Ranges at most this long are finished with insertion sort.
+    static const int InsertionSortLength = 16;
+
+    static void swapItems(T& A, T& B)
+    {
+      T SwapValue = Memory::Movable(A);
+      A = Memory::Movable(B);
+      B = Memory::Movable(SwapValue);
+    }
+
+    ///Stable insertion sort of Count elements.
+    static void insertionSort(T* ArrayData, int Count)
+    {
+      for(int i = 1; i < Count; i++)
+      {
+        if(!(ArrayData[i] < ArrayData[i - 1]))
+          continue;
+        T Value = Memory::Movable(ArrayData[i]);
+        int j = i;
+        for(; j > 0 && Value < ArrayData[j - 1]; j--)
+          ArrayData[j] = Memory::Movable(ArrayData[j - 1]);
+        ArrayData[j] = Memory::Movable(Value);
+      }
+    }
+
+    static void siftDown(T* ArrayData, int Root, int Count)
+    {
+      for(int Child = Root * 2 + 1; Child < Count; Child = Root * 2 + 1)
+      {
+        if(Child + 1 < Count && ArrayData[Child] < ArrayData[Child + 1])
+          Child++;
+        if(!(ArrayData[Root] < ArrayData[Child]))
+          return;
+        swapItems(ArrayData[Root], ArrayData[Child]);
+        Root = Child;
+      }
+    }
+
+    static void heapsort(T* ArrayData, int Count)
+    {
+      for(int i = Count / 2 - 1; i >= 0; i--)
+        siftDown(ArrayData, i, Count);
+      for(int i = Count - 1; i > 0; i--)
+      {
+        swapItems(ArrayData[0], ArrayData[i]);
+        siftDown(ArrayData, 0, i);
+      }
+    }
+
+    /**Private helper that implements introsort: quicksort on the median of
+    the first, middle and last elements, which splits sorted and reversed
+    input evenly, switching to heapsort for any range that still recurses
+    past DepthLimit so the worst case stays O(n log n).*/
+    static void introsortRecursive(T* ArrayData, int Count, int DepthLimit)
+    {
+      while(Count > InsertionSortLength)
+      {
+        if(DepthLimit-- == 0)
+        {
+          heapsort(ArrayData, Count);
+          return;
+        }
+
+        //Order the three samples and move the median to the front, so that
+        //the scans below always stop inside the range.
+        int Middle = Count / 2;
+        if(ArrayData[Middle] < ArrayData[1])
+          swapItems(ArrayData[Middle], ArrayData[1]);
+        if(ArrayData[Count - 1] < ArrayData[Middle])
+        {
+          swapItems(ArrayData[Count - 1], ArrayData[Middle]);
+          if(ArrayData[Middle] < ArrayData[1])
+            swapItems(ArrayData[Middle], ArrayData[1]);
+        }
+        swapItems(ArrayData[0], ArrayData[Middle]);
+
+        //Partition around the pivot at the front. Equal elements stop both
+        //scans, so runs of equal elements split evenly too.
+        int Left = 1, Right = Count - 1;
+        for(;;)
+        {
+          while(ArrayData[Left] < ArrayData[0])
+            Left++;
+          while(ArrayData[0] < ArrayData[Right])
+            Right--;
+          if(Left >= Right)
+            break;
+          swapItems(ArrayData[Left], ArrayData[Right]);
+          Left++;
+          Right--;
+        }
+
+        //Recurse into the smaller side and loop on the larger one.
+        if(Left < Count - Left)
+        {
+          introsortRecursive(ArrayData, Left, DepthLimit);
+          ArrayData += Left;
+          Count -= Left;
+        }
+        else
+        {
+          introsortRecursive(ArrayData + Left, Count - Left, DepthLimit);
+          Count = Left;
+        }
+      }
+      insertionSort(ArrayData, Count);
+    }
+
+    static int depthLimit(int Count)
+    {
+      int Limit = 0;
+      for(; Count > 1; Count >>= 1)
+        Limit += 2;
+      return Limit;
+    }
+
+    /**Merges the sorted runs [0, Middle) and [Middle, Count), taking from
+    the first run on ties. Buffer is uninitialized memory for Middle
+    elements.*/
+    static void merge(T* ArrayData, int Middle, int Count, T* Buffer)
+    {
+      //Nothing to do if the runs are already in order, as in sorted input.
+      if(Middle == 0 || Middle == Count ||
+        !(ArrayData[Middle] < ArrayData[Middle - 1]))
+          return;
+
+      for(int i = 0; i < Middle; i++)
+        new (&Buffer[i]) T(Memory::Movable(ArrayData[i]));
+
+      int i = 0, j = Middle, k = 0;
+      while(i < Middle && j < Count)
+      {
+        if(ArrayData[j] < Buffer[i])
+          ArrayData[k++] = Memory::Movable(ArrayData[j++]);
+        else
+          ArrayData[k++] = Memory::Movable(Buffer[i++]);
+      }
+      while(i < Middle)
+        ArrayData[k++] = Memory::Movable(Buffer[i++]);
+
+      for(i = 0; i < Middle; i++)
+        Buffer[i].~T();
+    }
+
+    ///Private helper that implements merge sort recursion.
+    static void mergeSortRecursive(T* ArrayData, int Count, T* Buffer)
     {
-      int Pivot, LeftIndex = Left, RightIndex = Right;
-      if(Right - Left <= 0)
+      if(Count <= InsertionSortLength)
+      {
+        insertionSort(ArrayData, Count);
         return;
-      Pivot = (Left + Right) / 2;
-      while(LeftIndex <= Pivot && RightIndex >= Pivot)
-      {    
-        while(ArrayData[LeftIndex] < ArrayData[Pivot] && LeftIndex <= Pivot)
-          LeftIndex = LeftIndex + 1;
-        
-        while(ArrayData[RightIndex] > ArrayData[Pivot] && RightIndex >= Pivot)
-             RightIndex = RightIndex - 1;
-        
-        T SwapValue = ArrayData[LeftIndex];
-        ArrayData[LeftIndex] = ArrayData[RightIndex];
-        ArrayData[RightIndex] = SwapValue;
-        LeftIndex++;
-        RightIndex--;
-        if(LeftIndex - 1 == Pivot)
-          Pivot = RightIndex = RightIndex + 1;
-        else if(RightIndex + 1 == Pivot)
-          Pivot = LeftIndex = LeftIndex - 1;
       }
-      quicksortRecursive(ArrayData, Left, Pivot - 1);
-      quicksortRecursive(ArrayData, Pivot + 1, Right);
+      int Middle = Count / 2;
+      mergeSortRecursive(ArrayData, Middle, Buffer);
+      mergeSortRecursive(ArrayData + Middle, Count - Middle, Buffer);
+      merge(ArrayData, Middle, Count, Buffer);
     }
-    
+
+#if MENC_ARRAY_THREADS
+    static void introsortRange(T* ArrayData, int Count)
+    {
+      introsortRecursive(ArrayData, Count, depthLimit(Count));
+    }
+#endif
+
     public:
     
-    ///Runs the Quicksort routine.
+    ///Runs the introsort routine (see introsort()).
     void quicksort(void)
     {
-      quicksortRecursive((T*)Data, 0, n() - 1);
+      introsort();
+    }
+
+    /**Sorts the array in O(n log n) time in the worst case, using only
+    operator<. Equal elements may change order.*/
+    void introsort(void)
+    {
+      introsortRecursive(Data, LogicalSize, depthLimit(LogicalSize));
+    }
+
+    /**Sorts the array with merge sort, keeping equal elements in their
+    original order. Uses a temporary buffer of half the array.*/
+    void stableSort(void)
+    {
+      if(LogicalSize <= InsertionSortLength)
+      {
+        insertionSort(Data, LogicalSize);
+        return;
+      }
+      T* Buffer = (T*)Allocator::allocate(sizeof(T) * (LogicalSize / 2));
+      mergeSortRecursive(Data, LogicalSize, Buffer);
+      Allocator::deallocate(Buffer, sizeof(T) * (LogicalSize / 2));
+    }
+
+    /**Sorts the array, splitting large arrays into a run per thread that
+    are sorted side by side and then merged pairwise. If NumThreads is 0
+    one thread per CPU is used. Small arrays, and compilers without
+    std::thread, get a plain sort(). Equal elements may change order.*/
+    void parallelSort(int NumThreads = 0)
+    {
+#if MENC_ARRAY_THREADS
+      if(NumThreads <= 0)
+        NumThreads = (int)std::thread::hardware_concurrency();
+
+      //Use a power-of-two number of runs of at least 8192 elements.
+      int Runs = 1;
+      while(Runs * 2 <= NumThreads && LogicalSize / (Runs * 2) >= 8192)
+        Runs *= 2;
+      if(Runs == 1 || isSorted())
+      {
+        sort();
+        return;
+      }
+
+      std::vector<int> Starts(Runs + 1);
+      for(int r = 0; r <= Runs; r++)
+        Starts[r] = (int)((int64)LogicalSize * r / Runs);
+
+      std::vector<std::thread> Threads;
+      for(int r = 1; r < Runs; r++)
+        Threads.push_back(std::thread(introsortRange, Data + Starts[r],
+          Starts[r + 1] - Starts[r]));
+      introsortRange(Data, Starts[1]);
+      for(size_t t = 0; t < Threads.size(); t++)
+        Threads[t].join();
+
+      //Each merge uses the part of the buffer under its first run.
+      T* Buffer = (T*)Allocator::allocate(sizeof(T) * LogicalSize);
+      for(int Width = 1; Width < Runs; Width *= 2)
+      {
+        Threads.clear();
+        for(int r = 0; r + Width < Runs; r += Width * 2)
+        {
+          int Start = Starts[r], Middle = Starts[r + Width];
+          int End = Starts[std::min(r + Width * 2, Runs)];
+          Threads.push_back(std::thread(merge, Data + Start, Middle - Start,
+            End - Start, Buffer + Start));
+        }
+        for(size_t t = 0; t < Threads.size(); t++)
+          Threads[t].join();
+      }
+      Allocator::deallocate(Buffer, sizeof(T) * LogicalSize);
+#else
+      (void)NumThreads;
+      sort();
+#endif
     }
     
     ///Returns whether or not the array is sorted.
-    bool isSorted(void)
+    bool isSorted(void) const
     {
-      for(int i = 0; i < n() - 1; i++)
+      for(int i = 0; i < LogicalSize - 1; i++)
       {
-        if(getItem(i) > getItem(i + 1))
+        if(Data[i + 1] < Data[i])
           return false;
       }
       return true;
@@ -555,14 +907,68 @@ namespace menc
       if(isSorted())
         return;
       
-      quicksort();
+      introsort();
+    }
+
+    /** Returns the index of the first element of a sorted array that is
+        not less than element, or size() if there is none. **/
+
+    int lowerBound(const T& element) const
+    {
+      int low = 0, high = LogicalSize;
+      while (low < high)
+        {
+          int middle = low + (high - low) / 2;
+          if (Data[middle] < element)
+            low = middle + 1;
+          else
+            high = middle;
+        }
+      return low;
+    }
+
+    /** Returns the index of the first element of a sorted array that is
+        greater than element, or size() if there is none. **/
+
+    int upperBound(const T& element) const
+    {
+      int low = 0, high = LogicalSize;
+      while (low < high)
+        {
+          int middle = low + (high - low) / 2;
+          if (element < Data[middle])
+            high = middle;
+          else
+            low = middle + 1;
+        }
+      return low;
+    }
+
+    /** Returns true if a sorted array contains element, by binary
+        search. **/
+
+    bool containsSorted(const T& element) const
+    {
+      return indexOfSorted(element) >= 0;
+    }
+
+    /** Returns the index of the first element of a sorted array equal to
+        element, or -1 if it isn't found. **/
+
+    int indexOfSorted(const T& element) const
+    {
+      int i = lowerBound(element);
+      if (i < LogicalSize && !(element < Data[i]))
+        return i;
+      return -1;
     }
     
-    ///Adds an element to the array and then sorts the array.
+    /** Inserts an element into a sorted array after any elements equal
+        to it, keeping the array sorted. **/
+
     void addSorted(const T& newElement)
     {
-      add(newElement);
-      sort();
+      insert(upperBound(newElement), newElement);
     }
 
     ///Deletes elements and clears array.
@@ -13,6 +13,21 @@
 
 namespace menc
 {
+  /** BitfieldLayout describes one field of a Bitfield at compile time:
+      its index, width and mask are constants, so the read and write
+      overloads taking a layout compile to a single shift and mask. Fields
+      must be 1 to 32 bits wide. **/
+
+  template <int Index, int Width>
+  struct BitfieldLayout
+  {
+    static const int index = Index;
+    static const int width = Width;
+
+    //(2 << 31) - 1 wraps to all ones for a 32-bit field
+    static const uint32 mask = ((uint32)2 << (Width - 1)) - 1;
+  };
+
   template <class Size>
   class Bitfield
   {
@@ -20,82 +35,61 @@ namespace menc
     //Derived classes should not have to know about the internal representation
     Size bits;
 
+    //The low bits_to_take bits set, for 0 to 32 bits
+    static inline Size mask(Size bits_to_take)
+    {
+      return bits_to_take >= 32 ? (Size)0xFFFFFFFF :
+        (Size)(((uint32)1 << bits_to_take) - 1);
+    }
+
   protected:
     inline void write(Size bit_index, Size bits_to_take, Size value)
     {
-      uint32 masks[33] = {0, //0
-        1,3,7,15,31,63,127,255, //1-8
-        511,1023,2047,4095,8191,16383,32767,65535, //9-16
-        131071,262143,524287,1048575,2097151,4194303,8388607,16777215, //17-24
-        33554431,67108863,134217727,268435455,536870911,1073741823,2147483647,
-          0xFFFFFFFF}; //25-31
-
-      //Operator Key
-      // |   Inclusive OR
-      // ^   Exclusive OR (T + T = F)
-      // &   AND
-      // <<  Shift bits UP by some number
-      // >>  Shift bits DOWN by some number
-
       //WRITE Algorithm
-      //Efficiency: 2 OR, 2 AND, 1 BITSHIFT = 5 bitwise operations
-      bits = 
-      ( //1-out anything in the mask area and leave the rest untouched, 
-        //i.e. rrrrrrr11rrr
-        bits 
-
-        |
-
-        (
-        (Size)masks[bits_to_take] << bit_index  //COMPILER OPTIMIZED CONSTANT
-        )
-      )
-
-      &  
-
-      ( //i.e. 111111vv111, where v is an arbitrary data value
-        (
-          ( //Prevent overflow errors by masking bits higher than the range
-            (Size)value 
-            & 
-            (Size)masks[bits_to_take] //COMPILER OPTIMIZED CONSTANT
-          )
-          <<
-          bit_index
-        )
-
-        | 
-
-        ( //The following creates an 'inverse' of the transposed mask, 
-          //i.e. 11111100111
-          (Size)masks[sizeof(Size)<<3] 
-          ^
-          (
-            (Size)masks[bits_to_take] << bit_index
-          )
-        ) //COMPILER OPTIMIZED CONSTANT
-      );
+      //Clear the field, then OR in the value masked to the field's width
+      Size field = mask(bits_to_take) << bit_index;
+      bits = (bits & ~field) | (((Size)value << bit_index) & field);
     }
 
     inline Size read(Size bit_index=0, Size bits_to_take=32) const
     {
-      uint32 masks[33] = {0, //0
-        1,3,7,15,31,63,127,255, //1-8
-        511,1023,2047,4095,8191,16383,32767,65535, //9-16
-        131071,262143,524287,1048575,2097151,4194303,8388607,16777215, //17-24
-        33554431,67108863,134217727,268435455,536870911,1073741823,2147483647,
-          0xFFFFFFFF}; //25-31
-
-      //Operator Key
-      // |   Inclusive OR
-      // ^   Exclusive OR (T + T = F)
-      // &   AND
-      // <<  Shift bits UP by some number
-      // >>  Shift bits DOWN by some number
-
       //READ Algorithm
       //Efficiency: 1 BITSHIFT, 1 AND = 2 bitwise operations
-      return (bits >> bit_index) & (Size)masks[bits_to_take];
+      return (bits >> bit_index) & mask(bits_to_take);
+    }
+
+    template <class Layout>
+    inline void write(Size value)
+    {
+      const Size field = (Size)Layout::mask << Layout::index;
+      bits = (bits & ~field) | (((Size)value << Layout::index) & field);
+    }
+
+    template <class Layout>
+    inline Size read() const
+    {
+      return (bits >> Layout::index) & (Size)Layout::mask;
+    }
+
+    /** Reads a field stored as a magnitude with a sign bit on top, as
+        writeSignedInteger writes it. **/
+
+    template <class Layout>
+    inline int readSignedInteger() const
+    {
+      int magnitude = (int)((bits >> Layout::index) &
+        ((Size)Layout::mask >> 1));
+      return ((bits >> (Layout::index + Layout::width - 1)) & 1) ?
+        -magnitude : magnitude;
+    }
+
+    template <class Layout>
+    inline void writeSignedInteger(int value)
+    {
+      Size magnitude = (Size)(value < 0 ? -value : value) &
+        ((Size)Layout::mask >> 1);
+      write<Layout>(value < 0 ?
+        magnitude | ((Size)1 << (Layout::width - 1)) : magnitude);
     }
 
     inline bool readBool(Size bit_index) const
@@ -159,27 +153,31 @@ namespace menc
   {
   protected:
     static const BitfieldType Type = TemplateType;
+
+    typedef BitfieldLayout<23, 1> f_BitfieldValid; //BIT 23: valid
+    typedef BitfieldLayout<24, 8> f_BitfieldType; //BITS 24-31: type
+
   public:
     TypedBitfield(void)
     {
-      write(24,8,TemplateType); //Set upper 24 bits to the new type.
-      writeBool(23,true); //Assume that the bitfield is valid to begin with.
+      write<f_BitfieldType>(TemplateType); //Set upper 24 bits to the new type.
+      write<f_BitfieldValid>(1); //Assume that the bitfield is valid to begin with.
     }
 
     BitfieldType readType(void) const
     {
-      return read(24,8);
+      return read<f_BitfieldType>();
     }
 
     bool valid(void) const
     {
-      return (read(23,1)==1);
+      return (read<f_BitfieldValid>()==1);
     }
 
     void valid(bool isValid)
     {
       if(isValid)
-        writeBool(23,true);
+        write<f_BitfieldValid>(1);
       else
         write(0,24,0); //This erases all of the information except the type.
     }
@@ -255,6 +255,169 @@ namespace menc
   };
 
 
+  /** ChordNotes holds the notes of one chord, bass first, in a fixed
+      buffer inside the object, so chords can be built in a loop without
+      allocating. **/
+
+  class ChordNotes
+  {
+
+  public:
+
+    static const int MaxNotes = 4;
+
+    ChordNotes()
+      : count(0)
+    {
+    }
+
+    int size() const
+    {
+      return count;
+    }
+
+    Note& operator[](int i)
+    {
+      return notes[i];
+    }
+
+    const Note& operator[](int i) const
+    {
+      return notes[i];
+    }
+
+    void clear()
+    {
+      count = 0;
+    }
+
+    void add(Note note)
+    {
+      if (count < MaxNotes)
+        notes[count++] = note;
+    }
+
+  private:
+
+    Note notes[MaxNotes];
+    int count;
+  };
+
+  /** ChordVoicings holds, for each chord id and inversion, the intervals
+      of the upper chord notes above the bass as a constant table. The
+      augmented sixth chords are only voiced with the sixth above the
+      bass, whatever their inversion. **/
+
+  class ChordVoicings
+  {
+
+  private:
+
+    class Voicing
+    {
+
+    public:
+
+      ChordId id;
+      int8 inversions;
+      int8 size;
+      IntervalType intervals[4][3];
+    };
+
+    static const Voicing* find(ChordId id)
+    {
+      typedef IntervalTypes I;
+      static const Voicing voicings[] = {
+        {ChordIds::ItalianAugmentedSixth, 1, 2,
+         {{I::MajorThird, I::AugmentedSixth}}},
+        {ChordIds::GermanAugmentedSixth, 1, 3,
+         {{I::MajorThird, I::PerfectFifth, I::AugmentedSixth}}},
+        {ChordIds::FrenchAugmentedSixth, 1, 3,
+         {{I::MajorThird, I::AugmentedFourth, I::AugmentedSixth}}},
+        {ChordIds::SwissAugmentedSixth, 1, 3,
+         {{I::MajorThird, I::DoublyAugmentedFourth, I::AugmentedSixth}}},
+        {ChordIds::DiminishedSeventh, 4, 3,
+         {{I::MinorThird, I::DiminishedFifth, I::DiminishedSeventh},
+          {I::MinorThird, I::DiminishedFifth, I::MajorSixth},
+          {I::MinorThird, I::AugmentedFourth, I::MajorSixth},
+          {I::AugmentedSecond, I::AugmentedFourth, I::MajorSixth}}},
+        {ChordIds::HalfDiminishedSeventh, 4, 3,
+         {{I::MinorThird, I::DiminishedFifth, I::MinorSeventh},
+          {I::MinorThird, I::PerfectFifth, I::MajorSixth},
+          {I::MajorThird, I::AugmentedFourth, I::MajorSixth},
+          {I::MajorSecond, I::PerfectFourth, I::MinorSixth}}},
+        {ChordIds::MinorSeventh, 4, 3,
+         {{I::MinorThird, I::PerfectFifth, I::MinorSeventh},
+          {I::MajorThird, I::PerfectFifth, I::MajorSixth},
+          {I::MinorThird, I::PerfectFourth, I::MinorSixth},
+          {I::MajorSecond, I::PerfectFourth, I::MajorSixth}}},
+        {ChordIds::MinorMajorSeventh, 4, 3,
+         {{I::MinorThird, I::PerfectFifth, I::MajorSeventh},
+          {I::MajorThird, I::AugmentedFifth, I::MajorSixth},
+          {I::MajorThird, I::PerfectFourth, I::MinorSixth},
+          {I::MinorSecond, I::DiminishedFourth, I::MinorSixth}}},
+        {ChordIds::DominantSeventh, 4, 3,
+         {{I::MajorThird, I::PerfectFifth, I::MinorSeventh},
+          {I::MinorThird, I::DiminishedFifth, I::MinorSixth},
+          {I::MinorThird, I::PerfectFourth, I::MajorSixth},
+          {I::MajorSecond, I::AugmentedFourth, I::MajorSixth}}},
+        {ChordIds::MajorSeventh, 4, 3,
+         {{I::MajorThird, I::PerfectFifth, I::MajorSeventh},
+          {I::MinorThird, I::PerfectFifth, I::MinorSixth},
+          {I::MajorThird, I::PerfectFourth, I::MajorSixth},
+          {I::MinorSecond, I::PerfectFourth, I::MinorSixth}}},
+        {ChordIds::AugmentedMajorSeventh, 4, 3,
+         {{I::MajorThird, I::AugmentedFifth, I::MajorSeventh},
+          {I::MajorThird, I::PerfectFifth, I::MinorSixth},
+          {I::MinorThird, I::DiminishedFourth, I::MinorSixth},
+          {I::MinorSecond, I::PerfectFourth, I::MajorSixth}}},
+        {ChordIds::DiminishedTriad, 3, 2,
+         {{I::MinorThird, I::DiminishedFifth},
+          {I::MinorThird, I::MajorSixth},
+          {I::AugmentedFourth, I::MajorSixth}}},
+        {ChordIds::MinorTriad, 3, 2,
+         {{I::MinorThird, I::PerfectFifth},
+          {I::MajorThird, I::MajorSixth},
+          {I::PerfectFourth, I::MinorSixth}}},
+        {ChordIds::MajorTriad, 3, 2,
+         {{I::MajorThird, I::PerfectFifth},
+          {I::MinorThird, I::MinorSixth},
+          {I::PerfectFourth, I::MajorSixth}}},
+        {ChordIds::AugmentedTriad, 3, 2,
+         {{I::MajorThird, I::AugmentedFifth},
+          {I::MajorThird, I::MinorSixth},
+          {I::DiminishedFourth, I::MinorSixth}}}};
+
+      for (int i = 0; i < (int)(sizeof(voicings) / sizeof(voicings[0])); i++)
+        if (voicings[i].id == id)
+          return &voicings[i];
+      return 0;
+    }
+
+  public:
+
+    /** Points intervals at the intervals above the bass of the chord id
+        in the inversion and returns how many there are, or returns 0 if
+        there is no such voicing. **/
+
+    static int intervalsAboveBass(ChordId id, ChordInversion inversion,
+                                  const IntervalType*& intervals)
+    {
+      const Voicing* voicing = find(id);
+      if (!voicing)
+        return 0;
+      int row = 0;
+      if (voicing->inversions > 1)
+      {
+        row = inversion - ChordInversions::RootPosition;
+        if (row < 0 || row >= voicing->inversions)
+          return 0;
+      }
+      intervals = voicing->intervals[row];
+      return voicing->size;
+    }
+  };
+
 /** ChordType
     5432 1098 7654 3210     (16 bits)
     ---- ---- ---- -000     untyped          Triad nibble
@@ -284,16 +447,22 @@ namespace menc
     
     static const int i_AllFields = 0;
     static const int n_AllFields = 16;
+    typedef BitfieldLayout<i_AllFields, n_AllFields> f_AllFields;
     static const int i_Triad = 0;
     static const int n_Triad = 4;
+    typedef BitfieldLayout<i_Triad, n_Triad> f_Triad;
     static const int i_Seventh = 4;
     static const int n_Seventh = 4;
+    typedef BitfieldLayout<i_Seventh, n_Seventh> f_Seventh;
     static const int i_Type = 0; //type = (seventh OR triad)
     static const int n_Type = 8;
+    typedef BitfieldLayout<i_Type, n_Type> f_Type;
     static const int i_Inversion = 8;
     static const int n_Inversion = 4;
+    typedef BitfieldLayout<i_Inversion, n_Inversion> f_Inversion;
     static const int i_Incomplete = 12;
     static const int n_Incomplete = 4;   
+    typedef BitfieldLayout<i_Incomplete, n_Incomplete> f_Incomplete;
     
   public:
     
@@ -400,57 +569,57 @@ namespace menc
     
     ChordQuality triad()
     {
-      return read(i_Triad, n_Triad);
+      return read<f_Triad>();
     }
     
     void triad(ChordQuality val)
     {
-      return write(i_Triad, n_Triad, val);
+      return write<f_Triad>(val);
     }
     
     ChordQuality seventh()
     {
-      return read(i_Seventh, n_Seventh);
+      return read<f_Seventh>();
     }
     
     void seventh(ChordQuality val)
     {
-      return write(i_Seventh, n_Seventh, val);
+      return write<f_Seventh>(val);
     }
     
     ChordQuality type()
     {
-      return read(i_Type, n_Type);
+      return read<f_Type>();
     }
 
     void type(ChordQuality val)
     {
-      return write(i_Type, n_Type, val);
+      return write<f_Type>(val);
     }
     
     ChordInversion inversion()
     {
-      return read(i_Inversion, n_Inversion);
+      return read<f_Inversion>();
     }
     
     void inversion(ChordInversion val)
     {
-      return write(i_Inversion, n_Inversion,val);
+      return write<f_Inversion>(val);
     }
 
     ChordMember incomplete()
     {
-      return read(i_Incomplete, n_Incomplete);
+      return read<f_Incomplete>();
     }
 
     void incomplete(ChordMember val)
     {
-      return write(i_Incomplete, n_Incomplete,val);
+      return write<f_Incomplete>(val);
     }
 
     int allFields()
     {
-      return read(i_AllFields, n_AllFields);
+      return read<f_AllFields>();
     }
     
     /** true is chord is not determined **/
@@ -1044,303 +1213,278 @@ namespace menc
       return text;
     }
 
+    /** Convert chord type into a chord (bass first) built on the
+        specified bass note. The chord is left empty if the type has no
+        voicing. Nothing is allocated. **/
+
+    void toChord(ChordNotes& notes, Note bass)
+    {
+      notes.clear();
+      const IntervalType* intervals;
+      int count = ChordVoicings::intervalsAboveBass(type(), inversion(), intervals);
+      if (count == 0)
+        return;
+      notes.add(bass);
+      for (int i = 0; i < count; i++)
+        notes.add(Interval::transpose(bass, intervals[i]));
+    }
+
     /** Convert chord type into a chord (array of notes) built on the
-        specified bass note. **/
+        specified bass note. The upper notes are appended and the bass is
+        inserted at the front of the array. **/
 
     void toChord(Array<Note>& notes, Note bass)
     {
-      switch (type())
+      ChordNotes chord;
+      toChord(chord, bass);
+      if (chord.size() == 0)
+        return;
+      for (int i = 1; i < chord.size(); i++)
+        notes.add(chord[i]);
+      notes.insert(0,bass);
+    }
+
+  };
+
+  /** The result of recognizing a pitch-class set as a chord: the chord
+      type (with inversion and missing members), its root as a pitch
+      class (0 = C .. 11 = B, or -1 when the set is not a chord) and the
+      set's transposition class, the lowest-valued rotation of its
+      pitch-class mask, which labels every set whether or not it is a
+      chord. **/
+
+  class RecognizedChord
+  {
+
+  public:
+
+    ChordType type;
+    int root;
+    int transpositionClass;
+
+    RecognizedChord()
+      : root(-1), transpositionClass(0)
+    {
+    }
+
+    bool isChord()
+    {
+      return root >= 0;
+    }
+  };
+
+  /** ChordRecognizer maps a 12-bit pitch-class mask (bit 0 = C, as in
+      PitchSet::getPitchClasses) to the tertian triad or seventh chord it
+      best spells, using a 4096-entry table built once on first use, so
+      recognizing each spectrum of a sweep costs one lookup.
+
+      A set is recognized as the chord whose members contain all of its
+      pitch classes and that lacks at most one member, provided at least
+      two members are present. Among candidates the one missing the least
+      important member wins (none, then the fifth or seventh, then the
+      third, then the root), then the more common chord type (major,
+      minor, dominant seventh, minor seventh, diminished, half-diminished
+      seventh, major seventh, diminished seventh, augmented, minor-major
+      seventh, augmented-major seventh), then the lower root. Augmented
+      sixth chords share their pitch classes with tertian chords and are
+      not reported. **/
+
+  class ChordRecognizer
+  {
+
+  private:
+
+    static const int NumTemplates = 11;
+    static const int NoTemplate = 0xFF;
+
+    /** Triad and seventh qualities of each chord type in order of
+        preference, with the semitones of the third, fifth and seventh
+        above the root (0 for no seventh). **/
+
+    static void getTemplate(int index, ChordQuality& triad, ChordQuality& seventh,
+                            int& third, int& fifth, int& sev)
+    {
+      static const ChordQuality triads[NumTemplates] = {
+        ChordQualities::Major, ChordQualities::Minor, ChordQualities::Major,
+        ChordQualities::Minor, ChordQualities::Diminished, ChordQualities::Diminished,
+        ChordQualities::Major, ChordQualities::Diminished, ChordQualities::Augmented,
+        ChordQualities::Minor, ChordQualities::Augmented};
+      static const ChordQuality sevenths[NumTemplates] = {
+        ChordQualities::Empty, ChordQualities::Empty, ChordQualities::Minor,
+        ChordQualities::Minor, ChordQualities::Empty, ChordQualities::Minor,
+        ChordQualities::Major, ChordQualities::Diminished, ChordQualities::Empty,
+        ChordQualities::Major, ChordQualities::Major};
+      static const int intervals[NumTemplates][3] = {
+        {4, 7, 0}, {3, 7, 0}, {4, 7, 10}, {3, 7, 10}, {3, 6, 0}, {3, 6, 10},
+        {4, 7, 11}, {3, 6, 9}, {4, 8, 0}, {3, 7, 11}, {4, 8, 11}};
+      triad = triads[index];
+      seventh = sevenths[index];
+      third = intervals[index][0];
+      fifth = intervals[index][1];
+      sev = intervals[index][2];
+    }
+
+    static int rotate(int mask, int semitones)
+    {
+      semitones = ((semitones % 12) + 12) % 12;
+      return ((mask << semitones) | (mask >> (12 - semitones))) & 0xFFF;
+    }
+
+    /** The pitch classes of a chord type on root 0. **/
+
+    static int templateMask(int index)
+    {
+      ChordQuality tri, sev;
+      int third, fifth, seventh;
+      getTemplate(index, tri, sev, third, fifth, seventh);
+      int mask = 1 | (1 << third) | (1 << fifth);
+      if (seventh > 0)
+        mask |= 1 << seventh;
+      return mask;
+    }
+
+    /** The members (ChordMembers bits) of a chord type on root 0 that
+        are not in set. **/
+
+    static int missingMembers(int index, int set)
+    {
+      ChordQuality tri, sev;
+      int third, fifth, seventh;
+      getTemplate(index, tri, sev, third, fifth, seventh);
+      int missing = ChordMembers::Empty;
+      if ((set & 1) == 0)
+        missing |= ChordMembers::Root;
+      if ((set & (1 << third)) == 0)
+        missing |= ChordMembers::Third;
+      if ((set & (1 << fifth)) == 0)
+        missing |= ChordMembers::Fifth;
+      if (seventh > 0 && (set & (1 << seventh)) == 0)
+        missing |= ChordMembers::Seventh;
+      return missing;
+    }
+
+    /** How much a chord is penalized for the members it lacks; 4 rules
+        it out. **/
+
+    static int missingCost(int missing)
+    {
+      if (missing == ChordMembers::Empty)
+        return 0;
+      else if ((missing & (missing - 1)) != 0)
+        return 4; //more than one member missing
+      else if (missing == ChordMembers::Fifth || missing == ChordMembers::Seventh)
+        return 1;
+      else if (missing == ChordMembers::Third)
+        return 2;
+      else
+        return 3;
+    }
+
+    class Table
+    {
+
+    public:
+
+      uint8 templates[4096];
+      int8 roots[4096];
+      uint8 missing[4096];
+      uint16 transpositionClasses[4096];
+
+      Table()
       {
-      case ChordIds::ItalianAugmentedSixth:
-        notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-        notes.add(Interval::transpose(bass, IntervalTypes::AugmentedSixth));
-        break;
-      case ChordIds::GermanAugmentedSixth:
-        notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-        notes.add(Interval::transpose(bass, IntervalTypes::PerfectFifth));
-        notes.add(Interval::transpose(bass, IntervalTypes::AugmentedSixth));
-        break;
-      case ChordIds::FrenchAugmentedSixth:
-        notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-        notes.add(Interval::transpose(bass, IntervalTypes::AugmentedFourth));
-        notes.add(Interval::transpose(bass, IntervalTypes::AugmentedSixth));
-        break;
-      case ChordIds::SwissAugmentedSixth:
-        notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-        notes.add(Interval::transpose(bass, IntervalTypes::fromQualityAndDistance(IntervalQualities::DoublyAugmented, IntervalDistances::Fourth)));
-        notes.add(Interval::transpose(bass, IntervalTypes::AugmentedSixth));
-        break;
-      case ChordIds::DiminishedSeventh:
-        switch (inversion())
-        {
-        case ChordInversions::RootPosition:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::DiminishedFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::DiminishedSeventh));
-          break;
-        case ChordInversions::FirstInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::DiminishedFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        case ChordInversions::SecondInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::AugmentedFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        case ChordInversions::ThirdInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::AugmentedSecond));
-          notes.add(Interval::transpose(bass, IntervalTypes::AugmentedFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        default:
-          return;
-        }  
-        break;
-      case ChordIds::HalfDiminishedSeventh:
-        switch (inversion())
-        {
-        case ChordInversions::RootPosition:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::DiminishedFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSeventh));
-          break;
-        case ChordInversions::FirstInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        case ChordInversions::SecondInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::AugmentedFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        case ChordInversions::ThirdInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSecond));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        default:
-          return;
-        }  
-        break;
-      case ChordIds::MinorSeventh:
-        switch (inversion())
-        {
-        case ChordInversions::RootPosition:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSeventh));
-          break;
-        case ChordInversions::FirstInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        case ChordInversions::SecondInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        case ChordInversions::ThirdInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSecond));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        default:
-          return;
-        }  
-        break;
-      case ChordIds::MinorMajorSeventh:
-        switch (inversion())
-        {
-        case ChordInversions::RootPosition:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSeventh));
-          break;
-        case ChordInversions::FirstInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::AugmentedFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        case ChordInversions::SecondInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        case ChordInversions::ThirdInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSecond));
-          notes.add(Interval::transpose(bass, IntervalTypes::DiminishedFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        default:
-          return;
-        }  
-        break;
-      case ChordIds::DominantSeventh:
-        switch (inversion())
-        {
-        case ChordInversions::RootPosition:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSeventh));
-          break;
-        case ChordInversions::FirstInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::DiminishedFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        case ChordInversions::SecondInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        case ChordInversions::ThirdInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSecond));
-          notes.add(Interval::transpose(bass, IntervalTypes::AugmentedFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        default:
-          return;
-        }  
-        break;
-      case ChordIds::MajorSeventh:
-        switch (inversion())
-        {
-        case ChordInversions::RootPosition:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSeventh));
-          break;
-        case ChordInversions::FirstInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        case ChordInversions::SecondInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        case ChordInversions::ThirdInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSecond));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        default:
-          return;
-        }  
-        break;
-      case ChordIds::AugmentedMajorSeventh:
-        switch (inversion())
-        {
-        case ChordInversions::RootPosition:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::AugmentedFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSeventh));
-          break;
-        case ChordInversions::FirstInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFifth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        case ChordInversions::SecondInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::DiminishedFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        case ChordInversions::ThirdInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSecond));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        default:
-          return;
-        }  
-        break;
-      case ChordIds::DiminishedTriad:
-        switch (inversion())
-        {
-        case ChordInversions::RootPosition:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::DiminishedFifth));
-          break;
-        case ChordInversions::FirstInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        case ChordInversions::SecondInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::AugmentedFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        default:
-          return;
-        }
-        break;
-      case ChordIds::MinorTriad:
-        switch (inversion())
-        {
-        case ChordInversions::RootPosition:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFifth));
-          break;
-        case ChordInversions::FirstInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        case ChordInversions::SecondInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        default:
-          return;
-        }
-        break;
-      case ChordIds::MajorTriad:
-        switch (inversion())
-        {
-        case ChordInversions::RootPosition:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFifth));
-          break;
-        case ChordInversions::FirstInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        case ChordInversions::SecondInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::PerfectFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorSixth));
-          break;
-        default:
-          return;
-        }
-        break;
-      case ChordIds::AugmentedTriad:
-        switch (inversion())
+        int masks[NumTemplates];
+        for (int t = 0; t < NumTemplates; t++)
+          masks[t] = templateMask(t);
+
+        for (int set = 0; set < 4096; set++)
         {
-        case ChordInversions::RootPosition:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::AugmentedFifth));
-          break;
-        case ChordInversions::FirstInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::MajorThird));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        case ChordInversions::SecondInversion:
-          notes.add(Interval::transpose(bass, IntervalTypes::DiminishedFourth));
-          notes.add(Interval::transpose(bass, IntervalTypes::MinorSixth));
-          break;
-        default:
-          return;
+          int lowest = set;
+          for (int r = 1; r < 12; r++)
+            if (rotate(set, r) < lowest)
+              lowest = rotate(set, r);
+          transpositionClasses[set] = (uint16)lowest;
+
+          templates[set] = NoTemplate;
+          roots[set] = -1;
+          missing[set] = ChordMembers::Empty;
+
+          int bestCost = 4;
+          for (int t = 0; t < NumTemplates; t++)
+            for (int root = 0; root < 12; root++)
+            {
+              int onRoot = rotate(set, -root);
+              if ((onRoot & ~masks[t]) != 0)
+                continue;
+              int members = missingMembers(t, onRoot);
+              int cost = missingCost(members);
+              int present = 0;
+              for (int b = 0; b < 12; b++)
+                present += (onRoot >> b) & 1;
+              if (cost >= bestCost || present < 2)
+                continue;
+              bestCost = cost;
+              templates[set] = (uint8)t;
+              roots[set] = (int8)root;
+              missing[set] = (uint8)members;
+            }
         }
-        break;
-      default:
-        return;
       }
-      notes.insert(0,bass);
+    };
+
+    static const Table& table()
+    {
+      static const Table t;
+      return t;
     }
 
+  public:
+
+    /** Recognizes a pitch-class mask. If bassPitchClass is given the
+        inversion is set from the chord member in the bass (empty if the
+        bass is not a member), and a symmetric chord (augmented triad,
+        diminished seventh) is rooted on the bass. **/
+
+    static RecognizedChord recognize(int pitchClasses, int bassPitchClass=-1)
+    {
+      const Table& t = table();
+      int set = pitchClasses & 0xFFF;
+      if (bassPitchClass >= 0)
+        bassPitchClass %= 12;
+
+      RecognizedChord chord;
+      chord.transpositionClass = t.transpositionClasses[set];
+      int index = t.templates[set];
+      if (index == NoTemplate)
+        return chord;
+
+      ChordQuality tri, sev;
+      int third, fifth, seventh;
+      getTemplate(index, tri, sev, third, fifth, seventh);
+
+      int root = t.roots[set];
+      ChordMember members = t.missing[set];
+      if (bassPitchClass >= 0 && members == ChordMembers::Empty
+          && rotate(templateMask(index), bassPitchClass) == set)
+        root = bassPitchClass;
+
+      ChordInversion inversion = ChordInversions::Empty;
+      if (bassPitchClass >= 0 && (set & (1 << bassPitchClass)) != 0)
+      {
+        int bass = ((bassPitchClass - root) % 12 + 12) % 12;
+        if (bass == 0)
+          inversion = ChordInversions::RootPosition;
+        else if (bass == third)
+          inversion = ChordInversions::FirstInversion;
+        else if (bass == fifth)
+          inversion = ChordInversions::SecondInversion;
+        else if (bass == seventh)
+          inversion = ChordInversions::ThirdInversion;
+      }
+
+      chord.type = ChordType(tri, sev, inversion, members);
+      chord.root = root;
+      return chord;
+    }
   };
 }
 
@@ -23,18 +23,22 @@ namespace menc
     //BIT 0: Force accidental to appear as cautionary (0, 1) = 1 bit
     static const int i_Force = 0; //index
     static const int n_Force = 1; //number of bits
+    typedef BitfieldLayout<i_Force, n_Force> f_Force;
 
     //BITS 1: Rest (0, 1) = 1 bit
     static const int i_Rest = 1; //index
     static const int n_Rest = 1; //number of bits
+    typedef BitfieldLayout<i_Rest, n_Rest> f_Rest;
 
     //BITS 2-6: Accidental (#,b,##,bb,nat) = 5 bit
     static const int i_Accidental = 2; //index
     static const int n_Accidental = 5; //number of bits
+    typedef BitfieldLayout<i_Accidental, n_Accidental> f_Accidental;
 
     //BITS 7-14: Line Space (-127 to 127) = 8 bit
     static const int i_LineSpace = 7; //index
     static const int n_LineSpace = 8; //number of bits
+    typedef BitfieldLayout<i_LineSpace, n_LineSpace> f_LineSpace;
 
     //BITS 15-22: 8 unused bits
 
@@ -46,8 +50,8 @@ namespace menc
       easy to compare notes based off of their vertical staff-wise position (as
       in, which one would be higher on the staff). So D-flat 5 > C-sharp 5, even
       though their MIDI key numbers would be the same.*/
-      return read(i_Accidental, n_Accidental) +
-        (read(i_LineSpace, n_LineSpace) << n_Accidental);
+      return read<f_Accidental>() +
+        (read<f_LineSpace>() << n_Accidental);
     }
 
   public:
@@ -106,23 +110,23 @@ namespace menc
     
     Accidental accidental(void) const
     {
-      return (Accidental)read(i_Accidental,n_Accidental);
+      return (Accidental)read<f_Accidental>();
     }
 
     void accidental(Accidental newAccidental)
     {
-      write(i_Accidental,n_Accidental,newAccidental);
+      write<f_Accidental>(newAccidental);
     }
     
     LineSpace lineSpace(void) const
     {
       //C = 0, D = 1, E = 2, F = 3, etc.
-      return (LineSpace)readSignedInteger(i_LineSpace, n_LineSpace);
+      return (LineSpace)readSignedInteger<f_LineSpace>();
     }
 
     void lineSpace(LineSpace newLineSpace)
     {
-      writeSignedInteger(i_LineSpace, n_LineSpace, newLineSpace);
+      writeSignedInteger<f_LineSpace>(newLineSpace);
     }
     
     Note note(Clef c)
@@ -171,9 +175,9 @@ namespace menc
       summary += "\nis rest: ";
       summary += readBool(i_Rest);
       summary += "\naccidental: ";
-      summary += read(i_Accidental, n_Accidental);
+      summary += read<f_Accidental>();
       summary += "\nlinespace: ";
-      summary += readSignedInteger(i_LineSpace, n_LineSpace);
+      summary += readSignedInteger<f_LineSpace>();
       summary += "\nvalid: ";
       summary += valid();
       summary += "\n-------------------";
@@ -211,7 +211,67 @@ namespace menc
     static const IntervalQuality Empty = -1;
     static const IntervalQuality AnyQuality = Empty;
     
+  private:
+
+    /** What betweenNotesByArithmetic gives for every pair of letters
+        C..B and stored accidentals, so betweenNotes is one lookup. **/
+    struct QualityTable
+    {
+      //qualities[(letter1 * 8 + accidental1) * 64 + letter2 * 8 + accidental2]
+      //for note 2 above note 1 and not a unison
+      int8 qualities[4096];
+
+      //unisons[accidental1 * 8 + accidental2]
+      int8 unisons[64];
+
+      QualityTable()
+      {
+        for (int note1 = 0; note1 < 64; note1++)
+          for (int note2 = 0; note2 < 64; note2++)
+            {
+              Letter letter1 = note1 >> 3, letter2 = note2 >> 3;
+              qualities[note1 * 64 + note2] = (int8)(letter1 < 7 && letter2 < 7 ?
+                betweenNotesByArithmetic(4, letter1, note1 & 7, 5, letter2, note2 & 7) : Empty);
+            }
+        for (int a1 = 0; a1 < 8; a1++)
+          for (int a2 = 0; a2 < 8; a2++)
+            unisons[a1 * 8 + a2] = (int8)betweenNotesByArithmetic(4, 0, a1, 4, 0, a2);
+      }
+    };
+
+    static const QualityTable& qualityTable()
+    {
+      static const QualityTable table;
+      return table;
+    }
+
+  public:
+
+    /** Returns the quality of the interval between two notes. Letters
+        C..B with any stored accidental are looked up in a table; other
+        values go through betweenNotesByArithmetic. **/
     static IntervalQuality betweenNotes(int octave1, Letter letter1, Accidental accidental1, int octave2, Letter letter2, Accidental accidental2)
+    {
+      if ((unsigned)letter1 > 6 || (unsigned)letter2 > 6 ||
+          (unsigned)accidental1 > 7 || (unsigned)accidental2 > 7)
+        return betweenNotesByArithmetic(octave1, letter1, accidental1,
+                                        octave2, letter2, accidental2);
+
+      const QualityTable& table = qualityTable();
+      int letter_index1 = octave1 * 7 + letter1;
+      int letter_index2 = octave2 * 7 + letter2;
+      int note1 = letter1 * 8 + accidental1;
+      int note2 = letter2 * 8 + accidental2;
+      if (letter_index1 == letter_index2)
+        return table.unisons[accidental1 * 8 + accidental2];
+      if (letter_index2 < letter_index1)
+        return table.qualities[note2 * 64 + note1];
+      return table.qualities[note1 * 64 + note2];
+    }
+
+    /** The original computation from the letter transition table and
+        the difference of the accidentals. **/
+    static IntervalQuality betweenNotesByArithmetic(int octave1, Letter letter1, Accidental accidental1, int octave2, Letter letter2, Accidental accidental2)
       {
     const IntervalQuality transition_table[7][7] =
     {
@@ -517,6 +577,7 @@ namespace menc
     static const IntervalType DiminishedFourth = (IntervalQualities::Diminished << QualityBits) + IntervalDistances::Fourth;
     static const IntervalType PerfectFourth = (IntervalQualities::Perfect << QualityBits) + IntervalDistances::Fourth;
     static const IntervalType AugmentedFourth = (IntervalQualities::Augmented << QualityBits) + IntervalDistances::Fourth;
+    static const IntervalType DoublyAugmentedFourth = (IntervalQualities::DoublyAugmented << QualityBits) + IntervalDistances::Fourth;
     static const IntervalType DiminishedFifth = (IntervalQualities::Diminished << QualityBits) + IntervalDistances::Fifth;
     static const IntervalType PerfectFifth = (IntervalQualities::Perfect << QualityBits) + IntervalDistances::Fifth;
     static const IntervalType AugmentedFifth = (IntervalQualities::Augmented << QualityBits) + IntervalDistances::Fifth;
@@ -619,14 +680,17 @@ namespace menc
     //BITS 1-4: Intervallic Quality (0-12) = 4 bits
     static const int i_Quality = 1;
     static const int n_Quality = 4;
+    typedef BitfieldLayout<i_Quality, n_Quality> f_Quality;
 
     //BITS 5-7: Intervallic Distance (1-8) = 3 bits
     static const int i_Distance = 5;
     static const int n_Distance = 3;
+    typedef BitfieldLayout<i_Distance, n_Distance> f_Distance;
 
     //BITS 8-11: Additional Octaves (0 to 15) = 4 bits
     static const int i_Octaves = 8;
     static const int n_Octaves = 4;
+    typedef BitfieldLayout<i_Octaves, n_Octaves> f_Octaves;
 
     //BITS 12-22: Unused
 
@@ -969,34 +1033,34 @@ namespace menc
     //Intervallic quality
     IntervalQuality quality(void)
     {
-      return read(i_Quality,n_Quality);
+      return read<f_Quality>();
     }
     
     void quality(IntervalQuality newQuality)
     {
-      write(i_Quality,n_Quality,newQuality);
+      write<f_Quality>(newQuality);
     }
     
     //Intervallic distance
     IntervalDistance distance(void)
     {
-      return read(i_Distance,n_Distance) + IntervalDistances::Unison;
+      return read<f_Distance>() + IntervalDistances::Unison;
     }
 
     void distance(IntervalDistance newDistance)
     {
-      write(i_Distance, n_Distance, newDistance - IntervalDistances::Unison);
+      write<f_Distance>(newDistance - IntervalDistances::Unison);
     }
     
     //Additional octaves
     int octaves(void)
     {
-      return read(i_Octaves,n_Octaves);
+      return read<f_Octaves>();
     }
     
     void octaves(int newOctaves)
     {
-      write(i_Octaves,n_Octaves,newOctaves);
+      write<f_Octaves>(newOctaves);
     }
     
     //Semitones
@@ -1351,7 +1415,94 @@ namespace menc
       return (octaves() >= 1);
     }
     
+  private:
+
+    /** The letter, accidental and octave shift that transposeByArithmetic
+        gives for each stored letter and accidental of a note and each
+        direction, quality and distance byte of an interval, so transposing
+        is one lookup. Additional octaves only move the octave and are
+        added afterwards. **/
+    struct TranspositionTable
+    {
+      //entry bits 0-2: letter, 3-5: accidental, 6-7: octave shift + 1
+      static const int Invalid = 1 << 8;
+
+      uint16 entries[64 * 256];
+
+      static int index(const Note& note, const Interval& interval)
+      {
+        return (((note.letter() << 3) | note.accidental()) << 8) |
+          interval.read(i_Direction, 1 + n_Quality + n_Distance);
+      }
+
+      TranspositionTable()
+      {
+        for (int letterAccidental = 0; letterAccidental < 64; letterAccidental++)
+          for (int byte = 0; byte < 256; byte++)
+            {
+              Note note(4, letterAccidental >> 3, letterAccidental & 7);
+              Interval interval;
+              interval.write(i_Direction, 1 + n_Quality + n_Distance, byte);
+              interval.octaves(0);
+              Note result = transposeByArithmetic(note, interval);
+              uint16& entry = entries[index(note, interval)];
+              if (!result.valid())
+                entry = Invalid;
+              else
+                entry = (uint16)(result.letter() | (result.accidental() << 3) |
+                                 ((result.octave() - 4 + 1) << 6));
+            }
+      }
+    };
+
+    static const TranspositionTable& transpositionTable()
+    {
+      static const TranspositionTable table;
+      return table;
+    }
+
+  public:
+
+    /** Returns the note an interval away from note, or an invalid note if
+        the result would need more than two sharps or flats. The spelling
+        comes from a table of what transposeByArithmetic gives. Results that
+        leave the octaves a Note can hold are handed to transposeByArithmetic
+        itself, so every result is the one it would give. **/
     static Note transpose(Note note, Interval interval)
+    {
+      int entry = transpositionTable().entries[TranspositionTable::index(note, interval)];
+      int octave = note.octave() + ((entry >> 6) & 3) - 1 +
+        interval.octaves() * interval.directionSign();
+      if (octave < -1 || octave > 14)
+        return transposeByArithmetic(note, interval);
+      if (entry & TranspositionTable::Invalid)
+        {
+          Note bad_note(-1);
+          bad_note.valid(false);
+          return bad_note;
+        }
+      return Note(octave, entry & 7, (entry >> 3) & 7);
+    }
+
+    /** Transposes notes[i] into results[i] for count notes. **/
+    static void transpose(const Note* notes, int count, Interval interval,
+                          Note* results)
+    {
+      for (int i = 0; i < count; i++)
+        results[i] = transpose(notes[i], interval);
+    }
+
+    /** Sets intervals[i] to the interval from notes1[i] to notes2[i]. **/
+    static void betweenNotes(const Note* notes1, const Note* notes2, int count,
+                             Interval* intervals)
+    {
+      for (int i = 0; i < count; i++)
+        intervals[i].betweenNotes(notes1[i], notes2[i]);
+    }
+
+    /** The original transposition, which spells the result by moving the
+        letter and comparing key numbers. **/
+    static Note transposeByArithmetic(Note note, Interval interval)
     {
       Octave o = note.octave();
       Letter l = note.letter();
@@ -1538,11 +1689,11 @@ namespace menc
         summary += "\ndirection: ";
         summary += String::intToString(readBool(i_Direction));
         summary += "\nquality: ";
-        summary += String::intToString(read(i_Quality,n_Quality));
+        summary += String::intToString(read<f_Quality>());
         summary += "\ndistance: ";
-        summary += String::intToString(read(i_Distance,n_Distance));
+        summary += String::intToString(read<f_Distance>());
         summary += "\nextra octaves: ";
-        summary += String::intToString(read(i_Octaves,n_Octaves));
+        summary += String::intToString(read<f_Octaves>());
         summary += "valid: ";
         summary += String::intToString(valid());
         summary += "-------------------";
@@ -387,228 +387,97 @@ namespace menc
       return Empty;
     }
     
+  private:
+
+    /** Bit s of tonalSignatures[p] is set when pitch p is diatonic in key
+        signature s, and bit s of raisedSignatures[p] when it is a raised
+        degree there; other pitches are lowered degrees. Rows are letters
+        and columns the accidentals from double flat to double sharp. **/
+
+    static uint16 tonalSignatures(Pitch p)
+    {
+      static const uint16 signatures[64] =
+        {
+          0x0000, 0x0006, 0x03f8, 0xfc00, 0x0000, 0x0000, 0x0000, 0x0000, //C
+          0x0000, 0x001e, 0x0fe0, 0xf000, 0x0000, 0x0000, 0x0000, 0x0000, //D
+          0x0000, 0x007e, 0x3f80, 0xc000, 0x0000, 0x0000, 0x0000, 0x0000, //E
+          0x0000, 0x0002, 0x01fc, 0xfe00, 0x0000, 0x0000, 0x0000, 0x0000, //F
+          0x0000, 0x000e, 0x07f0, 0xf800, 0x0000, 0x0000, 0x0000, 0x0000, //G
+          0x0000, 0x003e, 0x1fc0, 0xe000, 0x0000, 0x0000, 0x0000, 0x0000, //A
+          0x0000, 0x00fe, 0x7f00, 0x8000, 0x0000, 0x0000, 0x0000, 0x0000, //B
+          0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000  //Wild
+        };
+      return (p >= 0 && p < 64) ? signatures[p] : 0;
+    }
+
+    static uint16 raisedSignatures(Pitch p)
+    {
+      static const uint16 signatures[64] =
+        {
+          0x0000, 0x0000, 0x0007, 0x03ff, 0xffff, 0x0000, 0x0000, 0x0000, //C
+          0x0000, 0x0000, 0x001f, 0x0fff, 0xffff, 0x0000, 0x0000, 0x0000, //D
+          0x0000, 0x0000, 0x007f, 0x3fff, 0xffff, 0x0000, 0x0000, 0x0000, //E
+          0x0000, 0x0000, 0x0000, 0x01ff, 0xffff, 0x0000, 0x0000, 0x0000, //F
+          0x0000, 0x0000, 0x000f, 0x07ff, 0xffff, 0x0000, 0x0000, 0x0000, //G
+          0x0000, 0x0000, 0x003f, 0x1fff, 0xffff, 0x0000, 0x0000, 0x0000, //A
+          0x0000, 0x0000, 0x00ff, 0x7fff, 0xffff, 0x0000, 0x0000, 0x0000, //B
+          0x0000, 0x0000, 0x0000, 0x0000, 0xffff, 0x0000, 0x0000, 0x0000  //Wild
+        };
+      if (p >= 0 && p < 64)
+        return signatures[p];
+      return Pitches::toAccidental(p) == Accidentals::DoubleSharp ? 0xffff : 0;
+    }
+
+  public:
+
     /** return true if pitch is diatonic in key **/
 
     static bool isPitchTonal(Pitch p, Key k)
     {
-      KeySignature sig=signature(k);
-      switch (p)
-        {
-        case Pitches::Ff:
-          return (sig == KeySignatures::SevenFlats);
-        case Pitches::Cf:
-          return (sig == KeySignatures::SevenFlats || 
-                  sig == KeySignatures::SixFlats);
-        case Pitches::Gf:
-          return (sig >= KeySignatures::SevenFlats && 
-                  sig <= KeySignatures::FiveFlats);
-        case Pitches::Df:
-          return (sig >= KeySignatures::SevenFlats && 
-                  sig <= KeySignatures::FourFlats);
-        case Pitches::Af:
-          return (sig >= KeySignatures::SevenFlats && 
-                  sig <= KeySignatures::ThreeFlats);
-        case Pitches::Ef:
-          return (sig >= KeySignatures::SevenFlats && 
-                  sig <= KeySignatures::TwoFlats);
-        case Pitches::Bf:
-          return (sig >= KeySignatures::SevenFlats && 
-                  sig <= KeySignatures::OneFlat);
-        case Pitches::F:
-          return (sig >= KeySignatures::SixFlats && 
-                  sig <= KeySignatures::NoAccidentals);
-        case Pitches::C:
-          return (sig >= KeySignatures::FiveFlats && 
-                  sig <= KeySignatures::OneSharp);
-        case Pitches::G:
-          return (sig >= KeySignatures::FourFlats && 
-                  sig <= KeySignatures::TwoSharps);
-        case Pitches::D:
-          return (sig >= KeySignatures::ThreeFlats && 
-                  sig <= KeySignatures::ThreeSharps);
-        case Pitches::A:
-          return (sig >= KeySignatures::TwoFlats && 
-                  sig <= KeySignatures::FourSharps);
-        case Pitches::E:
-          return (sig >= KeySignatures::OneFlat && 
-                  sig <= KeySignatures::FiveSharps);
-        case Pitches::B:
-          return (sig >= KeySignatures::NoAccidentals && 
-                  sig <= KeySignatures::SixSharps);
-        case Pitches::Fs:
-          return (sig >= KeySignatures::OneSharp && 
-                  sig <= KeySignatures::SevenSharps);
-        case Pitches::Cs:
-          return (sig >= KeySignatures::TwoSharps && 
-                  sig <= KeySignatures::SevenSharps);
-        case Pitches::Gs:
-          return (sig >= KeySignatures::ThreeSharps && 
-                  sig <= KeySignatures::SevenSharps);
-        case Pitches::Ds:
-          return (sig >= KeySignatures::FourSharps && 
-                  sig <= KeySignatures::SevenSharps);
-        case Pitches::As:
-          return (sig >= KeySignatures::FiveSharps && 
-                  sig <= KeySignatures::SevenSharps);
-        case Pitches::Es:
-          return (sig == KeySignatures::SixSharps || 
-                  sig == KeySignatures::SevenSharps);
-        case Pitches::Bs:
-          return (sig == KeySignatures::SevenSharps);
-        default:
-          return false;
-        }
+      return ((tonalSignatures(p) >> signature(k)) & 1) != 0;
     }
-    
+
     /** returns the membership of pitch in key, where membership is one of 
         ScaleDegrees::Diatonic, ScaleDegrees::Lowered or ScaleDegrees::Raised **/
 
     static int pitchMembership(Pitch p, Key k)
     {
-      KeySignature sig=signature(k);
-      switch (p)
+      int sig=signature(k);
+      int diatonic=(tonalSignatures(p) >> sig) & 1;
+      int raised=(raisedSignatures(p) >> sig) & 1;
+      return ScaleDegrees::Lowered - diatonic + raised;
+    }
+
+    /** sets results[i] to isPitchTonal(pitches[i], k) **/
+
+    static void isPitchTonal(const Pitch* pitches, int count, Key k, bool* results)
+    {
+      for (int i=0; i<count; i++)
+        results[i]=isPitchTonal(pitches[i], k);
+    }
+
+    /** sets memberships[i] to pitchMembership(pitches[i], k) **/
+
+    static void pitchMembership(const Pitch* pitches, int count, Key k, int* memberships)
+    {
+      for (int i=0; i<count; i++)
+        memberships[i]=pitchMembership(pitches[i], k);
+    }
+
+    /** counts, for every key signature s (0 to 15), how many of the pitches
+        are diatonic in it. Membership does not depend on the mode, so
+        counts[signature(k)] scores any of the major and minor keys at
+        once. **/
+
+    static void countTonalPitches(const Pitch* pitches, int count, int counts[16])
+    {
+      for (int s=0; s<16; s++)
+        counts[s]=0;
+      for (int i=0; i<count; i++)
         {
-        case Pitches::Ff:
-          if (sig == KeySignatures::SevenFlats)
-            return ScaleDegrees::Diatonic;
-          else 
-            return ScaleDegrees::Lowered;
-        case Pitches::Cf:
-          if (sig == KeySignatures::SevenFlats || 
-              sig == KeySignatures::SixFlats)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Lowered;
-        case Pitches::Gf:
-          if (sig >= KeySignatures::SevenFlats && 
-              sig <= KeySignatures::FiveFlats)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Lowered;
-        case Pitches::Df:
-          if (sig >= KeySignatures::SevenFlats && 
-              sig <= KeySignatures::FourFlats)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Lowered;
-        case Pitches::Af:
-          if (sig >= KeySignatures::SevenFlats && 
-              sig <= KeySignatures::ThreeFlats)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Lowered;
-        case Pitches::Ef:
-          if (sig >= KeySignatures::SevenFlats && 
-              sig <= KeySignatures::TwoFlats)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Lowered;
-        case Pitches::Bf:
-          if (sig >= KeySignatures::SevenFlats && 
-              sig <= KeySignatures::OneFlat)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Lowered;
-        case Pitches::F:
-          if (sig >= KeySignatures::SixFlats && 
-              sig <= KeySignatures::NoAccidentals)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Lowered;
-        case Pitches::C:
-          if (sig >= KeySignatures::FiveFlats && 
-              sig <=  KeySignatures::OneSharp)
-            return ScaleDegrees::Diatonic;
-          else if (sig > KeySignatures::OneSharp)
-            return ScaleDegrees::Lowered;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::G:
-          if (sig >= KeySignatures::FourFlats && 
-              sig <= KeySignatures::TwoSharps)
-            return ScaleDegrees::Diatonic;
-          else if (sig > KeySignatures::TwoSharps)
-            return ScaleDegrees::Lowered;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::D:
-          if (sig >= KeySignatures::ThreeFlats && 
-              sig <= KeySignatures::ThreeSharps)
-            return ScaleDegrees::Diatonic;
-          else if (sig > KeySignatures::ThreeSharps)
-            return ScaleDegrees::Lowered;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::A:
-          if (sig >= KeySignatures::TwoFlats && 
-              sig <= KeySignatures::FourSharps)
-            return ScaleDegrees::Diatonic;
-          else if (sig > KeySignatures::FourSharps)
-            return ScaleDegrees::Lowered;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::E:
-          if (sig >= KeySignatures::OneFlat && 
-              sig <= KeySignatures::FiveSharps)
-            return ScaleDegrees::Diatonic;
-          else if (sig > KeySignatures::FiveSharps)
-            return ScaleDegrees::Lowered;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::B:
-          if (sig >= KeySignatures::NoAccidentals && 
-              sig <= KeySignatures::SixSharps)
-            return ScaleDegrees::Diatonic;
-          else if (sig > KeySignatures::SixSharps)
-            return ScaleDegrees::Lowered;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::Fs:
-          if (sig >= KeySignatures::OneSharp && 
-              sig <= KeySignatures::SevenSharps)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::Cs:
-          if (sig >= KeySignatures::TwoSharps && 
-              sig <= KeySignatures::SevenSharps)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::Gs:
-          if (sig >= KeySignatures::ThreeSharps && 
-              sig <= KeySignatures::SevenSharps)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::Ds:
-          if (sig >= KeySignatures::FourSharps && 
-              sig <= KeySignatures::SevenSharps)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::As:
-          if (sig >= KeySignatures::FiveSharps && 
-              sig <= KeySignatures::SevenSharps)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::Es:
-          if (sig == KeySignatures::SixSharps || 
-              sig == KeySignatures::SevenSharps)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Raised;
-        case Pitches::Bs:
-          if  (sig == KeySignatures::SevenSharps)
-            return ScaleDegrees::Diatonic;
-          else
-            return ScaleDegrees::Raised;
-        default:
-          if (Pitches::toAccidental(p) == Accidentals::DoubleSharp)
-            return ScaleDegrees::Raised;
-          else
-            return ScaleDegrees::Lowered;
+          uint16 tonal=tonalSignatures(pitches[i]);
+          for (int s=0; s<16; s++)
+            counts[s]+=(tonal >> s) & 1;
         }
     }
     
@@ -0,0 +1,548 @@
+/*=======================================================================*
+  Copyright (C) 2009-2011 William Andrew Burnson, Rick Taube.  This
+  program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License available at
+  http://www.gnu.org/licenses/gpl.html
+ *=======================================================================*/
+
+#ifndef mencMemory_h
+#define mencMemory_h
+
+#include <new>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include "mencTypes.h"
+#include "mencString.h"
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+  #include <mutex>
+  #define MENC_MEMORY_MUTEX 1
+  #define MENC_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+  #define MENC_THREAD_LOCAL __declspec(thread)
+#else
+  #define MENC_THREAD_LOCAL __thread
+#endif
+
+namespace menc
+{
+  /** MemoryResource is where menc containers get their heap memory from.
+      Array storage and ScoreData objects are allocated from the current
+      resource of the allocating thread, which is the plain new/delete
+      resource unless a ScopedMemoryResource has installed another, such
+      as an ArenaResource, a PoolResource or a TrackingResource.
+
+      Every allocation remembers the resource it came from and the
+      allocation site that was current when it was made, so it is freed
+      to the right resource and counted against the right site wherever
+      it is freed. **/
+
+  class MemoryResource
+  {
+
+  public:
+
+    virtual ~MemoryResource() {}
+
+    /** Returns Bytes of memory aligned for any menc type. Site is the
+        current allocation site, or 0 if none has been set. **/
+
+    virtual void* allocate(size_t Bytes, const char* Site) = 0;
+
+    /** Frees memory from allocate, given the same Bytes and Site. **/
+
+    virtual void deallocate(void* Data, size_t Bytes, const char* Site) = 0;
+
+    /** Returns the resource that uses plain new and delete. **/
+
+    static MemoryResource& newDelete();
+
+    /** Returns the resource allocations on this thread come from. **/
+
+    static MemoryResource& current()
+    {
+      MemoryResource* resource = currentResource();
+      return resource ? *resource : newDelete();
+    }
+
+    /** Returns the allocation site set on this thread, or 0. **/
+
+    static const char* currentSite()
+    {
+      return currentSiteName();
+    }
+
+    /** Allocates from the current resource, recording the resource and
+        the site in a header in front of the memory. **/
+
+    static void* allocateFromCurrent(size_t Bytes)
+    {
+      MemoryResource& resource = current();
+      const char* site = currentSite();
+      Header* header =
+        (Header*)resource.allocate(Bytes + HeaderSize, site);
+      if(!header)
+        return 0;
+      header->resource = &resource;
+      header->site = site;
+      header->bytes = Bytes;
+      return (unsigned char*)header + HeaderSize;
+    }
+
+    /** Frees memory from allocateFromCurrent to the resource it came
+        from. **/
+
+    static void deallocateToOwner(void* Data)
+    {
+      if(!Data)
+        return;
+      Header* header = (Header*)((unsigned char*)Data - HeaderSize);
+      header->resource->deallocate(header, header->bytes + HeaderSize,
+        header->site);
+    }
+
+  private:
+
+    friend class ScopedMemoryResource;
+    friend class ScopedAllocationSite;
+
+    struct Header
+    {
+      MemoryResource* resource;
+      const char* site;
+      size_t bytes;
+    };
+
+    //The header rounded up to keep the memory after it 16-byte aligned
+    static const size_t HeaderSize = (sizeof(Header) + 15) & ~(size_t)15;
+
+    class NewDeleteResource;
+
+    static MemoryResource*& currentResource()
+    {
+      static MENC_THREAD_LOCAL MemoryResource* resource = 0;
+      return resource;
+    }
+
+    static const char*& currentSiteName()
+    {
+      static MENC_THREAD_LOCAL const char* site = 0;
+      return site;
+    }
+  };
+
+  class MemoryResource::NewDeleteResource : public MemoryResource
+  {
+
+  public:
+
+    void* allocate(size_t Bytes, const char*)
+    {
+      return ::operator new(Bytes);
+    }
+
+    void deallocate(void* Data, size_t, const char*)
+    {
+      ::operator delete(Data);
+    }
+  };
+
+  inline MemoryResource& MemoryResource::newDelete()
+  {
+    static NewDeleteResource resource;
+    return resource;
+  }
+
+  /** ScopedMemoryResource makes a resource the current one on this
+      thread for its lifetime. The resource must outlive everything
+      allocated from it. **/
+
+  class ScopedMemoryResource
+  {
+
+  private:
+
+    MemoryResource* previous;
+
+    ScopedMemoryResource(const ScopedMemoryResource&);
+    ScopedMemoryResource& operator = (const ScopedMemoryResource&);
+
+  public:
+
+    ScopedMemoryResource(MemoryResource& resource)
+      : previous(MemoryResource::currentResource())
+    {
+      MemoryResource::currentResource() = &resource;
+    }
+
+    ~ScopedMemoryResource()
+    {
+      MemoryResource::currentResource() = previous;
+    }
+  };
+
+  /** ScopedAllocationSite names the allocations made on this thread for
+      its lifetime, e.g. ScopedAllocationSite site("parsePart"), so that
+      a TrackingResource can report them together. Site must be a string
+      that outlives the tracking, normally a literal. **/
+
+  class ScopedAllocationSite
+  {
+
+  private:
+
+    const char* previous;
+
+    ScopedAllocationSite(const ScopedAllocationSite&);
+    ScopedAllocationSite& operator = (const ScopedAllocationSite&);
+
+  public:
+
+    ScopedAllocationSite(const char* site)
+      : previous(MemoryResource::currentSiteName())
+    {
+      MemoryResource::currentSiteName() = site;
+    }
+
+    ~ScopedAllocationSite()
+    {
+      MemoryResource::currentSiteName() = previous;
+    }
+  };
+
+  /** ArenaResource hands out memory from large chunks by bumping a
+      pointer and frees nothing until release() or its destruction, which
+      suits building something whose parts all die together, such as a
+      parsed score. It is not thread-safe. **/
+
+  class ArenaResource : public MemoryResource
+  {
+
+  private:
+
+    struct Chunk
+    {
+      Chunk* next;
+      size_t bytes;
+    };
+
+    static const size_t ChunkHeaderSize = (sizeof(Chunk) + 15) & ~(size_t)15;
+
+    MemoryResource& upstream;
+    size_t chunkBytes;
+    Chunk* chunks;
+    unsigned char* position;
+    unsigned char* end;
+
+    ArenaResource(const ArenaResource&);
+    ArenaResource& operator = (const ArenaResource&);
+
+  public:
+
+    ArenaResource(size_t ChunkBytes = 65536,
+      MemoryResource& Upstream = MemoryResource::newDelete())
+      : upstream(Upstream), chunkBytes(ChunkBytes), chunks(0), position(0),
+        end(0)
+    {
+    }
+
+    ~ArenaResource()
+    {
+      release();
+    }
+
+    void* allocate(size_t Bytes, const char*)
+    {
+      Bytes = (Bytes + 15) & ~(size_t)15;
+      if(Bytes > (size_t)(end - position))
+      {
+        //Allocations bigger than a chunk get a chunk of their own.
+        size_t bytes = ChunkHeaderSize +
+          (Bytes > chunkBytes ? Bytes : chunkBytes);
+        Chunk* chunk = (Chunk*)upstream.allocate(bytes, 0);
+        chunk->next = chunks;
+        chunk->bytes = bytes;
+        chunks = chunk;
+        position = (unsigned char*)chunk + ChunkHeaderSize;
+        end = (unsigned char*)chunk + bytes;
+      }
+      void* data = position;
+      position += Bytes;
+      return data;
+    }
+
+    void deallocate(void*, size_t, const char*)
+    {
+    }
+
+    /** Frees all the memory handed out at once. **/
+
+    void release(void)
+    {
+      while(chunks)
+      {
+        Chunk* next = chunks->next;
+        upstream.deallocate(chunks, chunks->bytes, 0);
+        chunks = next;
+      }
+      position = end = 0;
+    }
+  };
+
+  /** PoolResource keeps freed blocks of up to MaxBlock bytes on a free
+      list per power-of-two size and reuses them, so containers growing
+      and shrinking over and over stop reaching the system allocator.
+      Larger blocks go straight upstream. It is not thread-safe. **/
+
+  class PoolResource : public MemoryResource
+  {
+
+  private:
+
+    static const int NumClasses = 7;       //16 to 1024 bytes
+    static const size_t MinBlock = 16;
+    static const size_t MaxBlock = MinBlock << (NumClasses - 1);
+    static const size_t ChunkBytes = 65536;
+
+    struct FreeBlock
+    {
+      FreeBlock* next;
+    };
+
+    MemoryResource& upstream;
+    FreeBlock* freeLists[NumClasses];
+    std::vector<void*> chunks;
+
+    static int sizeClass(size_t Bytes)
+    {
+      int c = 0;
+      for(size_t size = MinBlock; size < Bytes; size <<= 1)
+        c++;
+      return c;
+    }
+
+    PoolResource(const PoolResource&);
+    PoolResource& operator = (const PoolResource&);
+
+  public:
+
+    PoolResource(MemoryResource& Upstream = MemoryResource::newDelete())
+      : upstream(Upstream)
+    {
+      for(int c = 0; c < NumClasses; c++)
+        freeLists[c] = 0;
+    }
+
+    ~PoolResource()
+    {
+      release();
+    }
+
+    void* allocate(size_t Bytes, const char* Site)
+    {
+      if(Bytes > MaxBlock)
+        return upstream.allocate(Bytes, Site);
+
+      int c = sizeClass(Bytes);
+      if(!freeLists[c])
+      {
+        //Carve a new chunk into blocks of this size.
+        size_t block = MinBlock << c;
+        unsigned char* chunk =
+          (unsigned char*)upstream.allocate(ChunkBytes, 0);
+        chunks.push_back(chunk);
+        for(size_t offset = 0; offset + block <= ChunkBytes; offset += block)
+        {
+          FreeBlock* block = (FreeBlock*)(chunk + offset);
+          block->next = freeLists[c];
+          freeLists[c] = block;
+        }
+      }
+      FreeBlock* block = freeLists[c];
+      freeLists[c] = block->next;
+      return block;
+    }
+
+    void deallocate(void* Data, size_t Bytes, const char* Site)
+    {
+      if(Bytes > MaxBlock)
+      {
+        upstream.deallocate(Data, Bytes, Site);
+        return;
+      }
+      int c = sizeClass(Bytes);
+      FreeBlock* block = (FreeBlock*)Data;
+      block->next = freeLists[c];
+      freeLists[c] = block;
+    }
+
+    /** Frees the pooled chunks. Blocks still in use become invalid. **/
+
+    void release(void)
+    {
+      for(size_t i = 0; i < chunks.size(); i++)
+        upstream.deallocate(chunks[i], ChunkBytes, 0);
+      chunks.clear();
+      for(int c = 0; c < NumClasses; c++)
+        freeLists[c] = 0;
+    }
+  };
+
+  /** TrackingResource passes allocations on to another resource and
+      counts them per allocation site (see ScopedAllocationSite): how
+      many blocks and bytes were allocated, how many bytes are live and
+      the peak of the live bytes. Allocations made outside any site are
+      counted under "(no site)". It may be shared by several threads when
+      the compiler provides std::mutex. **/
+
+  class TrackingResource : public MemoryResource
+  {
+
+  public:
+
+    struct SiteStatistics
+    {
+      const char* site;
+      uint64 allocations;
+      uint64 deallocations;
+      uint64 bytes;
+      uint64 liveBytes;
+      uint64 peakBytes;
+    };
+
+  private:
+
+    MemoryResource& upstream;
+    std::vector<SiteStatistics> sites;
+    SiteStatistics total;
+#if MENC_MEMORY_MUTEX
+    std::mutex lock;
+#endif
+
+    static void clearStatistics(SiteStatistics& statistics, const char* site)
+    {
+      memset(&statistics, 0, sizeof(statistics));
+      statistics.site = site;
+    }
+
+    SiteStatistics& statisticsFor(const char* site)
+    {
+      if(!site)
+        site = "(no site)";
+      for(size_t i = 0; i < sites.size(); i++)
+        if(sites[i].site == site || strcmp(sites[i].site, site) == 0)
+          return sites[i];
+      SiteStatistics statistics;
+      clearStatistics(statistics, site);
+      sites.push_back(statistics);
+      return sites.back();
+    }
+
+    static void countAllocation(SiteStatistics& statistics, size_t Bytes)
+    {
+      statistics.allocations++;
+      statistics.bytes += Bytes;
+      statistics.liveBytes += Bytes;
+      if(statistics.liveBytes > statistics.peakBytes)
+        statistics.peakBytes = statistics.liveBytes;
+    }
+
+    static void countDeallocation(SiteStatistics& statistics, size_t Bytes)
+    {
+      statistics.deallocations++;
+      statistics.liveBytes -= Bytes < statistics.liveBytes ?
+        Bytes : statistics.liveBytes;
+    }
+
+    TrackingResource(const TrackingResource&);
+    TrackingResource& operator = (const TrackingResource&);
+
+  public:
+
+    TrackingResource(MemoryResource& Upstream = MemoryResource::newDelete())
+      : upstream(Upstream)
+    {
+      clearStatistics(total, "(total)");
+    }
+
+    void* allocate(size_t Bytes, const char* Site)
+    {
+      void* data = upstream.allocate(Bytes, Site);
+#if MENC_MEMORY_MUTEX
+      std::lock_guard<std::mutex> guard(lock);
+#endif
+      countAllocation(statisticsFor(Site), Bytes);
+      countAllocation(total, Bytes);
+      return data;
+    }
+
+    void deallocate(void* Data, size_t Bytes, const char* Site)
+    {
+      upstream.deallocate(Data, Bytes, Site);
+#if MENC_MEMORY_MUTEX
+      std::lock_guard<std::mutex> guard(lock);
+#endif
+      countDeallocation(statisticsFor(Site), Bytes);
+      countDeallocation(total, Bytes);
+    }
+
+    /** Returns a copy of the statistics of every site seen so far. **/
+
+    std::vector<SiteStatistics> getSites(void)
+    {
+#if MENC_MEMORY_MUTEX
+      std::lock_guard<std::mutex> guard(lock);
+#endif
+      return sites;
+    }
+
+    /** Returns the statistics of all sites together. **/
+
+    SiteStatistics getTotal(void)
+    {
+#if MENC_MEMORY_MUTEX
+      std::lock_guard<std::mutex> guard(lock);
+#endif
+      return total;
+    }
+
+    /** Forgets the counts so far. Memory that was live at the reset is
+        counted as a free but not taken off the live bytes below 0. **/
+
+    void reset(void)
+    {
+#if MENC_MEMORY_MUTEX
+      std::lock_guard<std::mutex> guard(lock);
+#endif
+      sites.clear();
+      clearStatistics(total, "(total)");
+    }
+
+    /** Returns a table of the statistics, one line per site and a line
+        for the total. **/
+
+    String toString(void)
+    {
+      std::vector<SiteStatistics> all = getSites();
+      all.push_back(getTotal());
+      String str = "site                         allocs      frees"
+        "        bytes         live         peak\n";
+      for(size_t i = 0; i < all.size(); i++)
+      {
+        char line[160];
+        snprintf(line, sizeof(line), "%-24s %10llu %10llu %12llu %12llu %12llu\n",
+          all[i].site, (unsigned long long)all[i].allocations,
+          (unsigned long long)all[i].deallocations,
+          (unsigned long long)all[i].bytes,
+          (unsigned long long)all[i].liveBytes,
+          (unsigned long long)all[i].peakBytes);
+        str += line;
+      }
+      return str;
+    }
+  };
+}
+
+#endif
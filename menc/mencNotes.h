@@ -11,6 +11,7 @@
 #include "mencBitfields.h"
 #include "mencPitches.h"
 #include <math.h>  // for 'pow' and 'log'
+#include <string.h>  // for 'memcpy'
 #include <iostream>
 
 namespace menc
@@ -32,30 +33,37 @@ namespace menc
     //BIT 0: Force accidental to appear as cautionary (0, 1) = 1 bit
     static const int i_Force = 0; //index
     static const int n_Force = 1; //number of bits
+    typedef BitfieldLayout<i_Force, n_Force> f_Force;
 
     //BITS 1-4 (SIGNED): Tuning (-7 to 7) = 3 bits + 1 bit sign
     static const int i_Tune = 1; //index
     static const int n_Tune = 4; //number of bits
+    typedef BitfieldLayout<i_Tune, n_Tune> f_Tune;
 
     //BITS 5-7: Accidental (#,b,##,bb,nat) = 3 bit
     static const int i_Accidental = 5; //index
     static const int n_Accidental = 3; //number of bits
+    typedef BitfieldLayout<i_Accidental, n_Accidental> f_Accidental;
 
     //BITS 8-10: Letter (0-6) = 3 bit
     static const int i_Letter = 8; //index
     static const int n_Letter = 3; //number of bits
+    typedef BitfieldLayout<i_Letter, n_Letter> f_Letter;
 
     //BITS 11-14: Octave number (0 to 15) = 4 bits
     static const int i_Octave = 11; //index
     static const int n_Octave = 4; //number of bits
+    typedef BitfieldLayout<i_Octave, n_Octave> f_Octave;
 
     //BITS 15-16: Voice number (1 to 4) = 2 bits
     static const int i_Voice = 15; //index
     static const int n_Voice = 2; //number of bits
+    typedef BitfieldLayout<i_Voice, n_Voice> f_Voice;
 
     //BITS 17: Rest (0, 1) = 1 bit
     static const int i_Rest = 17; //index
     static const int n_Rest = 1; //number of bits
+    typedef BitfieldLayout<i_Rest, n_Rest> f_Rest;
 
     //BITS 18-22: 5 unused bits
 
@@ -72,6 +80,162 @@ namespace menc
       return read(i_Accidental, n_Accidental + n_Letter + n_Octave);
     }
 
+    /** What fromFrequencyByLog writes for each eighth-tone step
+        (8 * key number + tuning) of MIDI keys lowestKey..highestKey, and
+        the smallest frequency at which it reaches that step. The bounds
+        are found by bisecting the bit patterns of positive floats with
+        fromFrequencyByLog itself, so a lookup gives exactly the notes the
+        log conversion gives, whatever the platform's log rounds to. **/
+    struct FrequencyTable
+    {
+      static const int lowestKey = 1;
+      static const int highestKey = 126;
+      static const int firstStep = lowestKey * 8 - 3;
+      static const int endStep = (highestKey + 1) * 8 - 3;
+      static const int numSteps = endStep - firstStep;
+
+      //The tuning, accidental, letter and octave bits, which are the
+      //only ones fromFrequencyByLog writes for a key in range.
+      static const int i_Fields = i_Tune;
+      static const int n_Fields = n_Tune + n_Accidental + n_Letter + n_Octave;
+      typedef BitfieldLayout<i_Fields, n_Fields> f_Fields;
+
+      //Buckets of 128 per octave, indexed by the top bits of the float
+      //between 1 Hz (0x3f80) and 12543 Hz (0x4643); each is narrower
+      //than two steps.
+      static const int bucketShift = 16;
+      static const int firstBucket = 0x3f80;
+      static const int numBuckets = 0x4644 - firstBucket;
+
+      //bounds[i] starts step firstStep + i; bounds[numSteps] ends the table
+      float bounds[numSteps + 1];
+      uint32 fields[numSteps];
+      int16 buckets[numBuckets];
+
+      static uint32 toBits(float f)
+      {
+        uint32 bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return bits;
+      }
+
+      static float fromBits(uint32 bits)
+      {
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        return f;
+      }
+
+      static int step(float frequency, uint32* fields=0)
+      {
+        Note n;
+        n.fromFrequencyByLog(frequency);
+        if(fields)
+          *fields = n.read<f_Fields>();
+        return n.toMIDIKeyNumber() * 8 + n.readSignedInteger<f_Tune>();
+      }
+
+      FrequencyTable()
+      {
+        //Search between 1 Hz and a frequency inside key 127. Above key
+        //127 the log conversion gives invalid notes, whose steps would
+        //break the ordering the bisection relies on.
+        uint32 lo = toBits((float)1.0), hi = toBits((float)12543.0);
+
+        //Positive floats sort like their bit patterns, so each bound is a
+        //bisection over integers. Steps only grow with frequency, so every
+        //search starts at the previous bound.
+        for(int i = 0; i <= numSteps; i++)
+          {
+            uint32 a = lo, b = hi;
+            while(a < b)
+              {
+                uint32 mid = a + (b - a) / 2;
+                if(step(fromBits(mid)) >= firstStep + i)
+                  b = mid;
+                else
+                  a = mid + 1;
+              }
+            bounds[i] = fromBits(a);
+            if(i < numSteps)
+              step(bounds[i], &fields[i]);
+            lo = a;
+          }
+
+        //Each bucket starts at the last step beginning at or below it.
+        int i = 0;
+        for(int b = 0; b < numBuckets; b++)
+          {
+            float start = fromBits((uint32)(firstBucket + b) << bucketShift);
+            while(i + 1 < numSteps && bounds[i + 1] <= start)
+              i++;
+            buckets[b] = (int16)i;
+          }
+      }
+
+      /** Returns the index of the step a frequency falls in, or -1 if it
+          lies outside the table (including zero, negative and NaN). **/
+      int lookup(float frequency) const
+      {
+        if(!(frequency >= bounds[0] && frequency < bounds[numSteps]))
+          return -1;
+
+        int i = buckets[(toBits(frequency) >> bucketShift) - firstBucket];
+        while(bounds[i + 1] <= frequency)
+          i++;
+        return i;
+      }
+    };
+
+    static const FrequencyTable& frequencyTable(void)
+    {
+      static const FrequencyTable table;
+      return table;
+    }
+
+    /** The names toStringByConcatenation and toPrettyStringByConcatenation
+        build for every value of the accidental, letter and octave bits of
+        a valid note that is not a rest, so toName and toPrettyName are one
+        lookup and build no String. **/
+    struct NameTable
+    {
+      static const int i_Fields = i_Accidental;
+      static const int n_Fields = n_Accidental + n_Letter + n_Octave;
+      typedef BitfieldLayout<i_Fields, n_Fields> f_Fields;
+      static const int numNames = 1 << n_Fields;
+
+      //Longest is a one-letter name, "empty" and a two-digit octave
+      static const int maxLength = 11;
+
+      char names[numNames][maxLength + 1];
+      char prettyNames[numNames][maxLength + 1];
+
+      static void copy(char* name, const String& str)
+      {
+        size_t length = str.length() < (size_t)maxLength ?
+          str.length() : (size_t)maxLength;
+        memcpy(name, str.data(), length);
+        name[length] = 0;
+      }
+
+      NameTable()
+      {
+        for(int i = 0; i < numNames; i++)
+          {
+            Note n;
+            n.write<f_Fields>(i);
+            copy(names[i], n.toStringByConcatenation());
+            copy(prettyNames[i], n.toPrettyStringByConcatenation());
+          }
+      }
+    };
+
+    static const NameTable& nameTable(void)
+    {
+      static const NameTable table;
+      return table;
+    }
+
     void enforceMIDIKeyNumberRange(void)
     {
       int m = toMIDIKeyNumber();
@@ -123,7 +287,44 @@ namespace menc
       fromString(name);
     }
 
+    /** Returns the name toString gives (e.g. "Ef4") as a string interned
+        in a table, without allocating. **/
+
+    const char* toName(void) const
+    {
+      if(!valid())
+        return "invalid";
+      if(read<f_Rest>())
+        return "R";
+      return nameTable().names[read<NameTable::f_Fields>()];
+    }
+
+    /** Returns the name toPrettyString gives (e.g. "Eb4") as a string
+        interned in a table, without allocating. **/
+
+    const char* toPrettyName(void) const
+    {
+      if(!valid())
+        return "invalid";
+      if(read<f_Rest>())
+        return "R";
+      return nameTable().prettyNames[read<NameTable::f_Fields>()];
+    }
+
     String toString(void)
+    {
+      return toName();
+    }
+
+    String toPrettyString (void)
+      {
+        return toPrettyName();
+      }
+
+    /** The original toString, concatenating the letter, accidental and
+        octave strings. **/
+
+    String toStringByConcatenation(void)
     {
       String str = Letters::toString(letter());
       if (valid())
@@ -141,7 +342,10 @@ namespace menc
       return str;
     }
 
-    String toPrettyString (void)
+    /** The original toPrettyString, concatenating the letter, accidental
+        and octave strings. **/
+
+    String toPrettyStringByConcatenation (void)
       {
         String str = Letters::toPrettyString(letter());
         if (valid())
@@ -214,33 +418,33 @@ namespace menc
 
     Octave octave(void) const
     {
-      return read(i_Octave,n_Octave) - 1;
+      return read<f_Octave>() - 1;
     }
 
     void octave(Octave newOctave)
     {
-      write(i_Octave,n_Octave,newOctave + 1);
+      write<f_Octave>(newOctave + 1);
     }
 
     Letter letter(void) const
     {
       //C = 0, D = 1, E = 2, F = 3, etc.
-      return (Letter)read(i_Letter,n_Letter);
+      return (Letter)read<f_Letter>();
     }
 
     void letter(Letter newLetter)
     {
-      write(i_Letter,n_Letter,newLetter);
+      write<f_Letter>(newLetter);
     }
 
     Accidental accidental(void) const
     {
-      return (Accidental)read(i_Accidental,n_Accidental);
+      return (Accidental)read<f_Accidental>();
     }
 
     void accidental(Accidental newAccidental)
     {
-      write(i_Accidental,n_Accidental,newAccidental);
+      write<f_Accidental>(newAccidental);
     }
 
     Pitch pitch(void) const
@@ -361,12 +565,12 @@ namespace menc
     
     int voice(void)
     {
-      return read(i_Voice,n_Voice);
+      return read<f_Voice>();
     }
 
     void voice(int voice)
     {
-      write(i_Voice,n_Voice,voice-1);
+      write<f_Voice>(voice-1);
     }
     
     bool isEmpty(void)
@@ -413,12 +617,12 @@ namespace menc
           t = -((-t)%8);
         }
       
-      writeSignedInteger(i_Tune,n_Tune,t); //note: signed
+      writeSignedInteger<f_Tune>(t); //note: signed
     }
     
     float semitoneTuning(void)
     {
-      int t=readSignedInteger(i_Tune,n_Tune);
+      int t=readSignedInteger<f_Tune>();
       return ((float)t)/(float)8.0;
     }
     
@@ -429,7 +633,50 @@ namespace menc
       return (float)440.0 * pow((float)2.0,mf);
     }
     
+    /** Sets the key number and eighth-tone tuning nearest to frequency.
+        Frequencies between MIDI keys 1 and 126 are looked up in a table
+        of step boundaries instead of computing two logs; the result is
+        identical to fromFrequencyByLog, which handles everything else.
+        Note that semitoneTuning() respells the key, so in range the
+        result is spelled with flats whatever preferSharp says. **/
     void fromFrequency(float frequency, bool preferSharp=true)
+    {
+      const FrequencyTable& table = frequencyTable();
+      int i = table.lookup(frequency);
+      if(i < 0)
+        fromFrequencyByLog(frequency, preferSharp);
+      else
+        write<FrequencyTable::f_Fields>(table.fields[i]);
+    }
+
+    /** Converts frequencies[i] into notes[i] as fromFrequency does. Fields
+        that fromFrequency leaves alone (validity, voice, rest) are carried
+        over from the previous note, so the result matches reusing one Note
+        for the whole array; notes[0] starts from its own value. **/
+    static void fromFrequencies(const float* frequencies, int count,
+                                Note* notes, bool preferSharp=true)
+    {
+      for(int i = 0; i < count; i++)
+        {
+          if(i > 0)
+            notes[i] = notes[i - 1];
+          notes[i].fromFrequency(frequencies[i], preferSharp);
+        }
+    }
+
+    static void fromFrequencies(const double* frequencies, int count,
+                                Note* notes, bool preferSharp=true)
+    {
+      for(int i = 0; i < count; i++)
+        {
+          if(i > 0)
+            notes[i] = notes[i - 1];
+          notes[i].fromFrequency((float)frequencies[i], preferSharp);
+        }
+    }
+
+    /** The original conversion through two float logs. **/
+    void fromFrequencyByLog(float frequency, bool preferSharp=true)
     {
       float base=log(frequency/(float)440.0)/log((float)2.0);
       float mf=base*(float)12.0+(float)69.0;
@@ -510,13 +757,13 @@ namespace menc
       summary += "\nforce accidental: ";
       summary += readBool(i_Force);
       summary += "\ntuning: ";
-      summary += readSignedInteger(i_Tune,n_Tune);
+      summary += readSignedInteger<f_Tune>();
       summary += "\naccidental: ";
-      summary += read(i_Accidental,n_Accidental);
+      summary += read<f_Accidental>();
       summary += "\nletter: ";
-      summary += read(i_Letter,n_Letter);
+      summary += read<f_Letter>();
       summary += "\noctave: ";
-      summary += read(i_Octave,n_Octave);
+      summary += read<f_Octave>();
       summary += "\nvalid: ";
       summary += valid();
       summary += "\n-------------------";
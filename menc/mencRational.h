@@ -268,7 +268,7 @@ namespace menc
 
     Rational<IntegralType> operator-=(Rational<IntegralType> other)
     {
-      *this = *this + other;
+      *this = *this - other;
       return *this;
     }
 
@@ -0,0 +1,301 @@
+/*=======================================================================*
+  Copyright (C) 2009-2011 William Andrew Burnson, Rick Taube.  This
+  program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License available at
+  http://www.gnu.org/licenses/gpl.html
+ *=======================================================================*/
+
+#ifndef mencSetClasses_h
+#define mencSetClasses_h
+
+#include "mencTypes.h"
+#include "mencString.h"
+
+namespace menc
+{
+
+  /** SetClass describes the set class of a pitch-class set: its prime
+      form, Forte number, interval vector and Z-relation, and the
+      transformation that takes the set to its prime form. Pitch-class
+      sets are 12-bit masks with bit 0 = C. **/
+
+  class SetClass
+  {
+
+  public:
+
+    //prime form mask (Rahn's, the most packed to the right)
+    uint16 prime;
+
+    //prime form mask of the Z-related set class, or 0 if there is none
+    uint16 zPartner;
+
+    //interval-class counts, 4 bits each, ic1 in the lowest nibble
+    uint32 intervals;
+
+    //number of pitch classes, 0 to 12
+    uint8 cardinality;
+
+    //position in Forte's list for the cardinality (1-based)
+    uint8 ordinal;
+
+    //prime = T(transposition) of the set, inverted first if inverted is set
+    uint8 transposition;
+    bool inverted;
+
+    SetClass()
+      : prime(0), zPartner(0), intervals(0), cardinality(0), ordinal(1),
+        transposition(0), inverted(false)
+    {
+    }
+
+    bool isZ() const
+    {
+      return zPartner != 0;
+    }
+
+    /** Returns how many times interval class ic (1 to 6) occurs. **/
+
+    int intervalCount(int ic) const
+    {
+      return (intervals >> ((ic - 1) * 4)) & 0xF;
+    }
+
+    /** Returns the Forte name, e.g. "4-Z15". **/
+
+    String toForteString() const
+    {
+      String str = String::intToString(cardinality);
+      str += isZ() ? "-Z" : "-";
+      str += String::intToString(ordinal);
+      return str;
+    }
+
+    /** Returns the prime form, e.g. "(0146)", with T and E for 10, 11. **/
+
+    String toPrimeFormString() const
+    {
+      static const char digits[] = "0123456789TE";
+      String str = "(";
+      for (int pc = 0; pc < 12; pc++)
+        if ((prime >> pc) & 1)
+          str += digits[pc];
+      str += ")";
+      return str;
+    }
+
+    /** Returns the interval vector, e.g. "<111111>", with T, E and C for
+        the counts 10 to 12 of the largest sets. **/
+
+    String toIntervalVectorString() const
+    {
+      static const char digits[] = "0123456789TEC";
+      String str = "<";
+      for (int ic = 1; ic <= 6; ic++)
+        str += digits[intervalCount(ic)];
+      str += ">";
+      return str;
+    }
+  };
+
+  /** SetClasses looks up the set class of any of the 4096 pitch-class
+      sets in a table built once on first use, so classifying a set costs
+      one indexed load instead of comparing 24 transformations. **/
+
+  class SetClasses
+  {
+
+  private:
+
+    static int rotate(int mask, int semitones)
+    {
+      semitones = ((semitones % 12) + 12) % 12;
+      return ((mask << semitones) | (mask >> (12 - semitones))) & 0xFFF;
+    }
+
+    static int invert(int mask)
+    {
+      int result = 0;
+      for (int pc = 0; pc < 12; pc++)
+        if ((mask >> pc) & 1)
+          result |= 1 << ((12 - pc) % 12);
+      return result;
+    }
+
+    static int countBits(int mask)
+    {
+      int n = 0;
+      for (; mask != 0; mask &= mask - 1)
+        n++;
+      return n;
+    }
+
+    static int parseSet(const char* text)
+    {
+      int mask = 0;
+      for (; *text; text++)
+        mask |= 1 << (*text == 'T' ? 10 : *text == 'E' ? 11 : *text - '0');
+      return mask;
+    }
+
+    /** Forte's lists of trichords to hexachords in his order, as Rahn
+        prime forms (which differ from Forte's own for 5-20, 6-Z29 and
+        6-31 here). Larger sets take the number of their complement. **/
+
+    static const char* const* forteList(int cardinality, int& count)
+    {
+      static const char* const trichords[] = {
+        "012", "013", "014", "015", "016", "024", "025", "026", "027", "036",
+        "037", "048"};
+      static const char* const tetrachords[] = {
+        "0123", "0124", "0134", "0125", "0126", "0127", "0145", "0156", "0167",
+        "0235", "0135", "0236", "0136", "0237", "0146", "0157", "0347", "0147",
+        "0148", "0158", "0246", "0247", "0257", "0248", "0268", "0358", "0258",
+        "0369", "0137"};
+      static const char* const pentachords[] = {
+        "01234", "01235", "01245", "01236", "01237", "01256", "01267", "02346",
+        "01246", "01346", "02347", "01356", "01248", "01257", "01268", "01347",
+        "01348", "01457", "01367", "01568", "01458", "01478", "02357", "01357",
+        "02358", "02458", "01358", "02368", "01368", "01468", "01369", "01469",
+        "02468", "02469", "02479", "01247", "03458", "01258"};
+      static const char* const hexachords[] = {
+        "012345", "012346", "012356", "012456", "012367", "012567", "012678",
+        "023457", "012357", "013457", "012457", "012467", "013467", "013458",
+        "012458", "014568", "012478", "012578", "013478", "014589", "023468",
+        "012468", "023568", "013468", "013568", "013578", "013469", "013569",
+        "023679", "013679", "014579", "024579", "023579", "013579", "02468T",
+        "012347", "012348", "012378", "023458", "012358", "012368", "012369",
+        "012568", "012569", "023469", "012469", "012479", "012579", "013479",
+        "014679"};
+
+      switch (cardinality)
+      {
+      case 3: count = 12; return trichords;
+      case 4: count = 29; return tetrachords;
+      case 5: count = 38; return pentachords;
+      case 6: count = 50; return hexachords;
+      default: count = 0; return 0;
+      }
+    }
+
+    static int intervalVector(int mask)
+    {
+      int vector = 0;
+      for (int ic = 1; ic <= 6; ic++)
+      {
+        int n = countBits(mask & rotate(mask, ic));
+        if (ic == 6)
+          n /= 2;
+        vector |= n << ((ic - 1) * 4);
+      }
+      return vector;
+    }
+
+    class Table
+    {
+
+    public:
+
+      SetClass classes[4096];
+
+      Table()
+      {
+        for (int set = 0; set < 4096; set++)
+        {
+          SetClass& c = classes[set];
+          c.cardinality = (uint8)countBits(set);
+          c.intervals = (uint32)intervalVector(set);
+
+          //The prime form is the smallest of the 24 transformations:
+          //comparing masks compares the highest pitch classes first.
+          int best = 0xFFFF;
+          for (int inverted = 0; inverted < 2; inverted++)
+          {
+            int source = inverted ? invert(set) : set;
+            for (int t = 0; t < 12; t++)
+            {
+              int candidate = rotate(source, t);
+              if (candidate < best)
+              {
+                best = candidate;
+                c.transposition = (uint8)t;
+                c.inverted = inverted != 0;
+              }
+            }
+          }
+          c.prime = (uint16)best;
+        }
+
+        //Z-related classes share an interval vector; in 12 tones each
+        //has exactly one partner.
+        int primes[224], numPrimes = 0;
+        for (int set = 0; set < 4096; set++)
+          if (classes[set].prime == set)
+            primes[numPrimes++] = set;
+        for (int i = 0; i < numPrimes; i++)
+          for (int j = 0; j < numPrimes; j++)
+            if (i != j && classes[primes[i]].intervals == classes[primes[j]].intervals &&
+                classes[primes[i]].cardinality == classes[primes[j]].cardinality)
+              classes[primes[i]].zPartner = (uint16)primes[j];
+
+        //Forte numbers of trichords to hexachords from the lists, of
+        //dyads by interval class (2-1 to 2-6), and of larger sets after
+        //their complements.
+        for (int n = 3; n <= 6; n++)
+        {
+          int count;
+          const char* const* list = forteList(n, count);
+          for (int i = 0; i < count; i++)
+            setOrdinal(parseSet(list[i]), i + 1);
+        }
+        for (int ic = 1; ic <= 6; ic++)
+          setOrdinal(1 | (1 << ic), ic);
+        for (int i = 0; i < numPrimes; i++)
+        {
+          SetClass& c = classes[primes[i]];
+          if (c.cardinality >= 7)
+            c.ordinal = classes[classes[0xFFF & ~c.prime].prime].ordinal;
+        }
+
+        for (int set = 0; set < 4096; set++)
+        {
+          const SetClass& p = classes[classes[set].prime];
+          classes[set].ordinal = p.ordinal;
+          classes[set].zPartner = p.zPartner;
+        }
+      }
+
+      void setOrdinal(int prime, int ordinal)
+      {
+        classes[prime].ordinal = (uint8)ordinal;
+      }
+    };
+
+    static const Table& table()
+    {
+      static const Table t;
+      return t;
+    }
+
+  public:
+
+    /** Returns the set class of a pitch-class mask. **/
+
+    static const SetClass& fromPitchClasses(int pitchClasses)
+    {
+      return table().classes[pitchClasses & 0xFFF];
+    }
+
+    /** Classifies count masks into classes. **/
+
+    static void fromPitchClasses(const uint16* pitchClasses, int count,
+                                 SetClass* classes)
+    {
+      const Table& t = table();
+      for (int i = 0; i < count; i++)
+        classes[i] = t.classes[pitchClasses[i] & 0xFFF];
+    }
+  };
+}
+
+#endif
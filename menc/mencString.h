@@ -9,6 +9,12 @@
 #define mencString_h
 
 #include <string>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#ifndef _MSC_VER
+  #include <strings.h> //for strcasecmp
+#endif
 
 /** String is a lightweight string. This implementation uses
     basic_string and char. if you switch over to wstring then make
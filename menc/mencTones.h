@@ -113,10 +113,13 @@ namespace menc
     
     static const int i_AllFields = 0;
     static const int n_AllFields = 8;
+    typedef BitfieldLayout<i_AllFields, n_AllFields> f_AllFields;
     static const int i_Type = 0;
     static const int n_Type = 4;
+    typedef BitfieldLayout<i_Type, n_Type> f_Type;
     static const int i_Quality = 4;
     static const int n_Quality = 4;
+    typedef BitfieldLayout<i_Quality, n_Quality> f_Quality;
     
     bool testTypeAndQuality(ToneId ty, ToneId sub) 
     {
@@ -129,48 +132,48 @@ namespace menc
     
     ToneType() 
       {
-        write(i_AllFields, n_AllFields, ToneIds::Empty);
+        write<f_AllFields>(ToneIds::Empty);
       }
     
     ToneType(ToneId id) 
       {
-        write(i_AllFields, n_AllFields, id);
+        write<f_AllFields>(id);
       }
     
     ToneType(ToneId qual, ToneId typ)
       {
-        write(i_Quality, n_Quality, qual);
-        write(i_Type, n_Type, typ);
+        write<f_Quality>(qual);
+        write<f_Type>(typ);
       }
     
     ToneId typeAndQuality() const
     {
-      return (ToneId)read(i_AllFields, n_AllFields);
+      return (ToneId)read<f_AllFields>();
     } 
     
     bool isEmpty()
     {
-      return (read(i_AllFields, n_AllFields) == ToneIds::Empty);
+      return (read<f_AllFields>() == ToneIds::Empty);
     }
     
     ToneId type()
     {
-      return (ToneId)read(i_Type, n_Type);
+      return (ToneId)read<f_Type>();
     }
     
     void type(ToneId ty)
     {
-      write(i_Type, n_Type, ty);
+      write<f_Type>(ty);
     }
     
     ToneId quality()
     {
-      return (ToneId)read(i_Quality, n_Quality);
+      return (ToneId)read<f_Quality>();
     }
     
     void quality(ToneId ty)
     {
-      write(i_Quality, n_Quality, ty);
+      write<f_Quality>(ty);
     }
     
     bool isSame(ToneId id) 